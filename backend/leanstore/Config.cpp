@@ -84,10 +84,12 @@ DEFINE_bool(wal_fsync, false, "");
 DEFINE_int64(wal_variant, 0, "");
 DEFINE_uint64(wal_log_writers, 1, "");
 DEFINE_uint64(wal_buffer_size, 1024 * 1024 * 10, "");
+DEFINE_bool(wal_compact, false, "Group committer writes delta encoded chunks (varint LSN/GSN deltas) instead of raw WAL buffer ranges");
+DEFINE_bool(wal_lz4, false, "LZ4-compress compact WAL chunks, requires wal_compact");
 // -------------------------------------------------------------------------------------
 DEFINE_string(isolation_level, "si", "options: ru (READ_UNCOMMITTED), rc (READ_COMMITTED), si (SNAPSHOT_ISOLATION), ser (SERIALIZABLE)");
 DEFINE_bool(mv, true, "Multi-version");
-DEFINE_uint64(si_refresh_rate, 0, "");
+DEFINE_uint64(si_refresh_rate, 0, "Number of back-to-back read-only transactions that may reuse the previous snapshot (0 = always draw a fresh one)");
 DEFINE_bool(todo, true, "");
 // -------------------------------------------------------------------------------------
 DEFINE_bool(vi, true, "BTree with SI using in-place version");
@@ -116,6 +118,9 @@ DEFINE_double(garbage_in_page_pct, 15, "Threshold to trigger page-wise garbage c
 DEFINE_uint64(vi_max_chain_length, 1000, "");
 DEFINE_uint64(todo_batch_size, 1024, "");
 DEFINE_bool(history_tree_inserts, true, "");
+DEFINE_bool(gc_service, false, "Purge versions in a background thread instead of on the committing worker");
+DEFINE_uint64(gc_service_backlog, 4096, "Version backlog at which the GC service stops pausing between rounds");
+DEFINE_uint64(gc_service_sleep_us, 1000, "Longest pause of the GC service between rounds (idle backlog)");
 // -------------------------------------------------------------------------------------
 DEFINE_bool(persist, false, "");
 DEFINE_bool(recover, false, "");
@@ -79,6 +79,8 @@ DECLARE_bool(wal_fsync);
 DECLARE_int64(wal_variant);
 DECLARE_uint64(wal_log_writers);
 DECLARE_uint64(wal_buffer_size);
+DECLARE_bool(wal_compact);
+DECLARE_bool(wal_lz4);
 // -------------------------------------------------------------------------------------
 DECLARE_string(isolation_level);
 DECLARE_bool(mv);
@@ -111,6 +113,9 @@ DECLARE_double(garbage_in_page_pct);
 DECLARE_uint64(vi_max_chain_length);
 DECLARE_uint64(todo_batch_size);
 DECLARE_bool(history_tree_inserts);
+DECLARE_bool(gc_service);
+DECLARE_uint64(gc_service_backlog);
+DECLARE_uint64(gc_service_sleep_us);
 // -------------------------------------------------------------------------------------
 DECLARE_bool(persist);
 DECLARE_bool(recover);
@@ -55,6 +55,12 @@ LeanStore::LeanStore()
    if (FLAGS_isolation_level == "si" && (!FLAGS_mv | !FLAGS_vi)) {
       SetupFailed("You have to enable mv and vi (multi-versioning) for snapshot isolation.");
    }
+   if (FLAGS_wal_compact && FLAGS_wal_variant != 0) {
+      SetupFailed("Compact WAL chunks are only written by the default group committer (wal_variant 0).");
+   }
+   if (FLAGS_wal_lz4 && !FLAGS_wal_compact) {
+      SetupFailed("You have to enable wal_compact to LZ4-compress the WAL.");
+   }
    // -------------------------------------------------------------------------------------
    // Set the default logger to file logger
    // Init SSD pool
@@ -89,6 +89,12 @@ CRManager::CRManager(HistoryTreeInterface& versions_space, s32 ssd_fd, u64 end_o
          }
       }
    }
+   // -------------------------------------------------------------------------------------
+   if (FLAGS_gc_service && FLAGS_todo) {
+      gc_service_running = true;
+      std::thread gc_service([&]() { garbageCollector(); });
+      gc_service.detach();
+   }
 }
 // -------------------------------------------------------------------------------------
 void CRManager::registerMeAsSpecialWorker()
@@ -124,6 +130,12 @@ void CRManager::scheduleJobs(u64 workers, std::function<void(u64 t_i)> job)
       setJob(t_i, [=]() { return job(t_i); });
    }
 }
+void CRManager::scheduleJobs(u64 first_worker, u64 workers, std::function<void(u64 t_i)> job)
+{
+   for (u64 t_i = first_worker; t_i < first_worker + workers; t_i++) {
+      setJob(t_i, [=]() { return job(t_i); });
+   }
+}
 
 // -------------------------------------------------------------------------------------
 void CRManager::joinAll()
@@ -133,6 +145,13 @@ void CRManager::joinAll()
    }
 }
 // -------------------------------------------------------------------------------------
+void CRManager::joinJobs(u64 first_worker, u64 workers)
+{
+   for (u64 t_i = first_worker; t_i < first_worker + workers; t_i++) {
+      joinOne(t_i, [&](WorkerThread& meta) { return meta.wt_ready && !meta.job_set; });
+   }
+}
+// -------------------------------------------------------------------------------------
 void CRManager::setJob(u64 t_i, std::function<void()> job)
 {
    ensure(t_i < workers_count);
@@ -173,7 +192,7 @@ CRManager::~CRManager()
    for (u64 t_i = 0; t_i < workers_count; t_i++) {
       worker_threads_meta[t_i].cv.notify_one();
    }
-   while (running_threads) {
+   while (running_threads || gc_service_running) {
    }
    for (u64 t_i = 0; t_i < workers_count; t_i++) {
       delete workers[t_i];
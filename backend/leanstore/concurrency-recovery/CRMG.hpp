@@ -30,6 +30,7 @@ class CRManager
    // -------------------------------------------------------------------------------------
    std::atomic<u64> running_threads = 0;
    std::atomic<bool> keep_running = true;
+   std::atomic<bool> gc_service_running = false;
    // -------------------------------------------------------------------------------------
    struct WorkerThread {
       std::mutex mutex;
@@ -67,6 +68,15 @@ class CRManager
     * @param job Job to do. Different for each worker.
     */
    void scheduleJobs(u64 workers, std::function<void(u64 t_i)> job);
+   /**
+    * @brief Schedule worker_id specific job on the workers [first_worker, first_worker + workers).
+    * Lets a job running on a lower worker fan out without scheduling onto itself.
+    *
+    * @param first_worker first worker to use
+    * @param workers amount of workers
+    * @param job Job to do, gets the worker id.
+    */
+   void scheduleJobs(u64 first_worker, u64 workers, std::function<void(u64 t_i)> job);
    /**
     * @brief Schedules one job asynchron on specific worker.
     *
@@ -86,6 +96,11 @@ class CRManager
     *
     */
    void joinAll();
+   /**
+    * @brief Waits for the workers [first_worker, first_worker + workers) to complete.
+    *
+    */
+   void joinJobs(u64 first_worker, u64 workers);
    // -------------------------------------------------------------------------------------
    // State Serialization
    std::unordered_map<std::string, std::string> serialize();
@@ -99,6 +114,7 @@ class CRManager
    void groupCommitCordinator();
    void groupCommiter1();
    void groupCommiter2();
+   void garbageCollector();
    // -------------------------------------------------------------------------------------
    /**
     * @brief Set the Job to specific worker.
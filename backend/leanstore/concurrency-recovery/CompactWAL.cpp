@@ -0,0 +1,188 @@
+#include "CompactWAL.hpp"
+
+#include "leanstore/Config.hpp"
+#include "leanstore/utils/Misc.hpp"
+// -------------------------------------------------------------------------------------
+#include <lz4.h>
+// -------------------------------------------------------------------------------------
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+// -------------------------------------------------------------------------------------
+namespace leanstore
+{
+namespace cr
+{
+// -------------------------------------------------------------------------------------
+namespace
+{
+inline u8* putVarint(u8* out, u64 value)
+{
+   while (value >= 0x80) {
+      *out++ = static_cast<u8>(value) | 0x80;
+      value >>= 7;
+   }
+   *out++ = static_cast<u8>(value);
+   return out;
+}
+// -------------------------------------------------------------------------------------
+inline const u8* getVarint(const u8* in, u64& value)
+{
+   value = 0;
+   for (u32 shift = 0;; shift += 7) {
+      const u8 byte = *in++;
+      value |= static_cast<u64>(byte & 0x7F) << shift;
+      if (!(byte & 0x80)) {
+         return in;
+      }
+   }
+}
+// -------------------------------------------------------------------------------------
+inline u64 zigzag(s64 value)
+{
+   return (static_cast<u64>(value) << 1) ^ static_cast<u64>(value >> 63);
+}
+// -------------------------------------------------------------------------------------
+inline s64 unzigzag(u64 value)
+{
+   return static_cast<s64>(value >> 1) ^ -static_cast<s64>(value & 1);
+}
+}  // namespace
+// -------------------------------------------------------------------------------------
+CompactWALWriter::CompactWALWriter()
+{
+   // Encoding never grows an entry: the varint header is smaller than WALDTEntry/WALMetaEntry
+   scratch = reinterpret_cast<u8*>(std::aligned_alloc(512, FLAGS_wal_buffer_size));
+   chunk = reinterpret_cast<u8*>(std::aligned_alloc(512, utils::upAlign(sizeof(CompactWALChunk) + FLAGS_wal_buffer_size)));
+}
+// -------------------------------------------------------------------------------------
+CompactWALWriter::~CompactWALWriter()
+{
+   std::free(scratch);
+   std::free(chunk);
+}
+// -------------------------------------------------------------------------------------
+u8* CompactWALWriter::encodeRange(u8* out, const u8* wal_buffer, u64 begin, u64 end, LID& prev_lsn, LID& prev_gsn)
+{
+   u64 cursor = begin;
+   while (cursor < end) {
+      const WALEntry& entry = *reinterpret_cast<const WALEntry*>(wal_buffer + cursor);
+      if (entry.type == WALEntry::TYPE::CARRIAGE_RETURN) {
+         break;
+      }
+      const LID lsn = entry.lsn.load(std::memory_order_relaxed);
+      *out++ = static_cast<u8>(entry.type);
+      out = putVarint(out, lsn - prev_lsn);
+      prev_lsn = lsn;
+      if (entry.type == WALEntry::TYPE::DT_SPECIFIC) {
+         const WALDTEntry& dt_entry = static_cast<const WALDTEntry&>(entry);
+         const u64 payload_length = entry.size - sizeof(WALDTEntry);
+         out = putVarint(out, payload_length);
+         out = putVarint(out, zigzag(static_cast<s64>(dt_entry.gsn - prev_gsn)));
+         prev_gsn = dt_entry.gsn;
+         out = putVarint(out, dt_entry.dt_id);
+         out = putVarint(out, dt_entry.pid);
+         std::memcpy(out, dt_entry.payload, payload_length);
+         out += payload_length;
+      }
+      cursor += entry.size;
+   }
+   return out;
+}
+// -------------------------------------------------------------------------------------
+u64 CompactWALWriter::encode(WORKERID worker_id, const u8* wal_buffer, u64 begin, u64 end)
+{
+   LID prev_lsn = 0, prev_gsn = 0;
+   u8* out = scratch;
+   if (begin < end) {
+      out = encodeRange(out, wal_buffer, begin, end, prev_lsn, prev_gsn);
+   } else {
+      out = encodeRange(out, wal_buffer, begin, FLAGS_wal_buffer_size, prev_lsn, prev_gsn);
+      out = encodeRange(out, wal_buffer, 0, end, prev_lsn, prev_gsn);
+   }
+   const u32 encoded_size = out - scratch;
+   // -------------------------------------------------------------------------------------
+   CompactWALChunk& header = *new (chunk) CompactWALChunk();
+   header.worker_id = worker_id;
+   header.flags = 0;
+   header.encoded_size = encoded_size;
+   header.stored_size = encoded_size;
+   if (FLAGS_wal_lz4 && encoded_size > 0) {
+      // LZ4 returns 0 when the result would not be smaller than the input, store it raw then
+      const int compressed_size = LZ4_compress_default(reinterpret_cast<const char*>(scratch), reinterpret_cast<char*>(header.payload),
+                                                       encoded_size, encoded_size - 1);
+      if (compressed_size > 0) {
+         header.flags |= CompactWALChunk::LZ4;
+         header.stored_size = compressed_size;
+      }
+   }
+   if (!(header.flags & CompactWALChunk::LZ4)) {
+      std::memcpy(header.payload, scratch, encoded_size);
+   }
+   header.crc = utils::CRC32C(header.payload, header.stored_size);
+   // -------------------------------------------------------------------------------------
+   const u64 chunk_size = sizeof(CompactWALChunk) + header.stored_size;
+   const u64 chunk_size_aligned = utils::upAlign(chunk_size);
+   std::memset(chunk + chunk_size, 0, chunk_size_aligned - chunk_size);
+   return chunk_size_aligned;
+}
+// -------------------------------------------------------------------------------------
+void decodeCompactWALChunk(const u8* chunk, std::function<void(const WALEntry& entry)> callback)
+{
+   const CompactWALChunk& header = *reinterpret_cast<const CompactWALChunk*>(chunk);
+   ensure(header.magic == CompactWALChunk::MAGIC);
+   ensure(utils::CRC32C(header.payload, header.stored_size) == header.crc);
+   // -------------------------------------------------------------------------------------
+   const u8* in = header.payload;
+   std::unique_ptr<u8[]> decompressed;
+   if (header.flags & CompactWALChunk::LZ4) {
+      decompressed = std::make_unique<u8[]>(header.encoded_size);
+      const int decompressed_size = LZ4_decompress_safe(reinterpret_cast<const char*>(header.payload), reinterpret_cast<char*>(decompressed.get()),
+                                                        header.stored_size, header.encoded_size);
+      ensure(decompressed_size == static_cast<int>(header.encoded_size));
+      in = decompressed.get();
+   }
+   const u8* in_end = in + header.encoded_size;
+   // -------------------------------------------------------------------------------------
+   // Entry sizes are u16, so one u64-aligned buffer fits every entry
+   std::vector<u64> entry_buffer((std::numeric_limits<u16>::max() + sizeof(u64)) / sizeof(u64));
+   u8* entry_ptr = reinterpret_cast<u8*>(entry_buffer.data());
+   LID prev_lsn = 0, prev_gsn = 0;
+   while (in < in_end) {
+      const auto type = static_cast<WALEntry::TYPE>(*in++);
+      u64 lsn_delta;
+      in = getVarint(in, lsn_delta);
+      prev_lsn += lsn_delta;
+      if (type == WALEntry::TYPE::DT_SPECIFIC) {
+         u64 payload_length, gsn_delta, dt_id, pid;
+         in = getVarint(in, payload_length);
+         in = getVarint(in, gsn_delta);
+         in = getVarint(in, dt_id);
+         in = getVarint(in, pid);
+         prev_gsn += unzigzag(gsn_delta);
+         // -------------------------------------------------------------------------------------
+         WALDTEntry& entry = *new (entry_ptr) WALDTEntry();
+         entry.lsn.store(prev_lsn, std::memory_order_relaxed);
+         entry.type = type;
+         entry.size = sizeof(WALDTEntry) + payload_length;
+         entry.gsn = prev_gsn;
+         entry.dt_id = dt_id;
+         entry.pid = pid;
+         std::memcpy(entry.payload, in, payload_length);
+         in += payload_length;
+         entry.computeCRC();
+         callback(entry);
+      } else {
+         WALMetaEntry& entry = *new (entry_ptr) WALMetaEntry();
+         entry.lsn.store(prev_lsn, std::memory_order_relaxed);
+         entry.type = type;
+         entry.size = sizeof(WALMetaEntry);
+         entry.computeCRC();
+         callback(entry);
+      }
+   }
+}
+// -------------------------------------------------------------------------------------
+}  // namespace cr
+}  // namespace leanstore
@@ -0,0 +1,52 @@
+#pragma once
+#include "Units.hpp"
+#include "Worker.hpp"
+// -------------------------------------------------------------------------------------
+// -------------------------------------------------------------------------------------
+#include <functional>
+// -------------------------------------------------------------------------------------
+namespace leanstore
+{
+namespace cr
+{
+// -------------------------------------------------------------------------------------
+// On-disk representation of a group commit chunk when --wal_compact is set.
+// Every entry is written as: type, varint LSN delta, and for DT entries varint payload length,
+// zigzag varint GSN delta, varint dt_id, varint pid followed by the raw payload (which already
+// carries XOR diffs for same-size in-place updates). Deltas are relative to the previous entry
+// of the same worker inside the chunk, so chunks can be decoded independently.
+struct CompactWALChunk {
+   static constexpr u32 MAGIC = 0x4357414C;
+   enum FLAGS : u8 { LZ4 = 1 };
+   // -------------------------------------------------------------------------------------
+   u32 magic = MAGIC;
+   u32 crc;  // CRC32C over payload[0, stored_size)
+   WORKERID worker_id;
+   u8 flags;
+   u32 encoded_size;  // Size after delta encoding
+   u32 stored_size;   // Size on disk, smaller than encoded_size when LZ4 paid off
+   u8 payload[];
+};
+// -------------------------------------------------------------------------------------
+class CompactWALWriter
+{
+  public:
+   CompactWALWriter();
+   ~CompactWALWriter();
+   // Encodes the entries of wal_buffer between the two cursors (following the carriage return when
+   // end < begin) into a single chunk, returns the 512-aligned number of bytes to write from data()
+   u64 encode(WORKERID worker_id, const u8* wal_buffer, u64 begin, u64 end);
+   u8* data() { return chunk; }
+
+  private:
+   u8* scratch;  // Delta encoded entries before compression
+   u8* chunk;    // CompactWALChunk followed by its payload
+   u8* encodeRange(u8* out, const u8* wal_buffer, u64 begin, u64 end, LID& prev_lsn, LID& prev_gsn);
+};
+// -------------------------------------------------------------------------------------
+// Rebuilds the original WAL entries of one chunk. There is no WAL replay yet, paranoid builds of the
+// group committer round trip every chunk through it against the wal_buffer it was encoded from
+void decodeCompactWALChunk(const u8* chunk, std::function<void(const WALEntry& entry)> callback);
+// -------------------------------------------------------------------------------------
+}  // namespace cr
+}  // namespace leanstore
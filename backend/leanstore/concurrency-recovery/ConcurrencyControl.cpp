@@ -4,6 +4,7 @@
 #include "leanstore/utils/Misc.hpp"
 // -------------------------------------------------------------------------------------
 #include <set>
+#include <tuple>
 // -------------------------------------------------------------------------------------
 namespace leanstore
 {
@@ -111,46 +112,65 @@ void Worker::ConcurrencyControl::garbageCollection()
    if (!FLAGS_todo) {
       return;
    }
+   if (FLAGS_gc_service) {  // The GC service purges in the background, the LWMs of this worker stay its own
+      std::tie(local_all_lwm, local_oltp_lwm) = receivedLWMs();
+      return;
+   }
+   collectGarbage(my().worker_id);
+}
+// -------------------------------------------------------------------------------------
+// all and OLTP LWM last published for this worker, read consistently
+std::pair<TXID, TXID> Worker::ConcurrencyControl::receivedLWMs()
+{
+   TXID all_lwm, oltp_lwm;
+   u64 lwm_version;
+   do {
+      while ((lwm_version = local_lwm_latch.load()) & 1)
+         ;
+      all_lwm = all_lwm_receiver.load();
+      oltp_lwm = oltp_lwm_receiver.load();
+   } while (lwm_version != local_lwm_latch.load());
+   ensure(!FLAGS_olap_mode || all_lwm <= oltp_lwm);
+   return {all_lwm, oltp_lwm};
+}
+// -------------------------------------------------------------------------------------
+// Purges the history of owner_worker_id (whose cc this is); runs on the owner or on the GC service thread
+void Worker::ConcurrencyControl::collectGarbage(WORKERID owner_worker_id)
+{
    // -------------------------------------------------------------------------------------
    // TODO: smooth purge, we should not let the system hang on this, as a quick fix, it should be enough if we purge in small batches
    utils::Timer timer(CRCounters::myCounters().cc_ms_gc);
-synclwm : {
-   u64 lwm_version = local_lwm_latch.load();
-   while ((lwm_version = local_lwm_latch.load()) & 1)
-      ;
-   local_all_lwm = all_lwm_receiver.load();
-   local_oltp_lwm = oltp_lwm_receiver.load();
-   if (lwm_version != local_lwm_latch.load()) {
-      goto synclwm;
-   }
-   ensure(!FLAGS_olap_mode || local_all_lwm <= local_oltp_lwm);
-}
+   // todo() checks against the LWMs of the running worker, so they go to its own cc: the owner's, or the GC service's
+   // copies, which leaves the owner's fields to the owner
+   const auto [all_lwm, oltp_lwm] = receivedLWMs();
+   my().cc.local_all_lwm = all_lwm;
+   my().cc.local_oltp_lwm = oltp_lwm;
    // ATTENTION: atm, with out extra sync, the two lwm can not
-   if (local_all_lwm > cleaned_untill_oltp_lwm) {
+   if (all_lwm > cleaned_untill_oltp_lwm) {
       utils::Timer timer(CRCounters::myCounters().cc_ms_gc_history_tree);
       // PURGE!
       history_tree.purgeVersions(
-          my().worker_id, 0, local_all_lwm - 1,
+          owner_worker_id, 0, all_lwm - 1,
           [&](const TXID tx_id, const DTID dt_id, const u8* version_payload, [[maybe_unused]] u64 version_payload_length, const bool called_before) {
-             leanstore::storage::DTRegistry::global_dt_registry.todo(dt_id, version_payload, my().worker_id, tx_id, called_before);
+             leanstore::storage::DTRegistry::global_dt_registry.todo(dt_id, version_payload, owner_worker_id, tx_id, called_before);
              COUNTERS_BLOCK()
              {
                 WorkerCounters::myCounters().cc_todo_olap_executed[dt_id]++;
              }
           },
           0);
-      cleaned_untill_oltp_lwm = std::max(local_all_lwm, cleaned_untill_oltp_lwm);
+      cleaned_untill_oltp_lwm = std::max(all_lwm, cleaned_untill_oltp_lwm);
    }
-   if (FLAGS_olap_mode && local_all_lwm != local_oltp_lwm) {
-      if (FLAGS_graveyard && local_oltp_lwm > 0 && local_oltp_lwm > cleaned_untill_oltp_lwm) {
+   if (FLAGS_olap_mode && all_lwm != oltp_lwm) {
+      if (FLAGS_graveyard && oltp_lwm > 0 && oltp_lwm > cleaned_untill_oltp_lwm) {
          utils::Timer timer(CRCounters::myCounters().cc_ms_gc_graveyard);
          // MOVE deletes to the graveyard
          const u64 from_tx_id = cleaned_untill_oltp_lwm > 0 ? cleaned_untill_oltp_lwm : 0;
-         history_tree.visitRemoveVersions(my().worker_id, from_tx_id, local_oltp_lwm - 1,
+         history_tree.visitRemoveVersions(owner_worker_id, from_tx_id, oltp_lwm - 1,
                                           [&](const TXID tx_id, const DTID dt_id, const u8* version_payload,
                                               [[maybe_unused]] u64 version_payload_length, const bool called_before) {
                                              cleaned_untill_oltp_lwm = std::max(cleaned_untill_oltp_lwm, tx_id + 1);
-                                             leanstore::storage::DTRegistry::global_dt_registry.todo(dt_id, version_payload, my().worker_id, tx_id,
+                                             leanstore::storage::DTRegistry::global_dt_registry.todo(dt_id, version_payload, owner_worker_id, tx_id,
                                                                                                      called_before);
                                              COUNTERS_BLOCK()
                                              {
@@ -0,0 +1,62 @@
+#include "CRMG.hpp"
+#include "leanstore/profiling/counters/CPUCounters.hpp"
+#include "leanstore/profiling/counters/CRCounters.hpp"
+// -------------------------------------------------------------------------------------
+// -------------------------------------------------------------------------------------
+#include <chrono>
+#include <thread>
+// -------------------------------------------------------------------------------------
+namespace leanstore
+{
+namespace cr
+{
+// -------------------------------------------------------------------------------------
+// Background purging of the per-worker version histories (--gc_service).
+// Each round purges every worker that inserted versions since its last effective purge; update versions go away
+// page-wise, remove versions are handed to todo() or moved to the graveyard exactly as on the commit path.
+// The pause between rounds shrinks linearly with the total backlog and disappears at gc_service_backlog; a round that
+// purges nothing, e.g. while a long transaction pins the LWM, always pauses in full instead of spinning.
+void CRManager::garbageCollector()
+{
+   std::string thread_name("gc_service");
+   pthread_setname_np(pthread_self(), thread_name.c_str());
+   if (FLAGS_cpu_counters) {
+      CPUCounters::registerThread(thread_name, false);
+   }
+   registerMeAsSpecialWorker();  // todo() runs against the LWMs of the calling worker
+   // -------------------------------------------------------------------------------------
+   while (keep_running) {
+      Worker::my().cc.refreshGlobalState();
+      u64 backlog = 0;
+      bool purged = false;
+      for (WORKERID w_i = 0; w_i < workers_count; w_i++) {
+         Worker::ConcurrencyControl& cc = workers[w_i]->cc;
+         const u64 inserted = cc.gc_versions_inserted.load(std::memory_order_relaxed);
+         if (inserted == cc.gc_versions_purged_mark) {
+            continue;
+         }
+         backlog += inserted - cc.gc_versions_purged_mark;
+         std::unique_lock<std::mutex> g(cc.gc_mutex);
+         const u64 cleaned_before = cc.cleaned_untill_oltp_lwm;
+         cc.collectGarbage(w_i);
+         if (cc.cleaned_untill_oltp_lwm != cleaned_before) {
+            cc.gc_versions_purged_mark = inserted;
+            purged = true;
+            CRCounters::myCounters().gc_service_purges++;
+         }
+      }
+      CRCounters::myCounters().gc_service_rounds++;
+      CRCounters::myCounters().gc_service_backlog = backlog;
+      // -------------------------------------------------------------------------------------
+      if (!purged || backlog < FLAGS_gc_service_backlog) {
+         const u64 pause_us =
+             purged ? FLAGS_gc_service_sleep_us * (FLAGS_gc_service_backlog - backlog) / FLAGS_gc_service_backlog : FLAGS_gc_service_sleep_us;
+         std::this_thread::sleep_for(std::chrono::microseconds(pause_us));
+      }
+   }
+   deleteSpecialWorker();
+   gc_service_running = false;
+}
+// -------------------------------------------------------------------------------------
+}  // namespace cr
+}  // namespace leanstore
@@ -1,4 +1,5 @@
 #include "CRMG.hpp"
+#include "CompactWAL.hpp"
 #include "leanstore/profiling/counters/CPUCounters.hpp"
 #include "leanstore/profiling/counters/CRCounters.hpp"
 #include "leanstore/profiling/counters/WorkerCounters.hpp"
@@ -62,6 +63,13 @@ void CRManager::groupCommiter()
    std::vector<Worker::Logging::WorkerToLW> wt_to_lw_copy;
    ready_to_commit_rfa_cut.resize(workers_count, 0);
    wt_to_lw_copy.resize(workers_count);
+   // One staging chunk per worker because all writes of a round are submitted together
+   std::vector<std::unique_ptr<CompactWALWriter>> compact_writers;
+   if (FLAGS_wal_compact) {
+      for (u32 w_i = 0; w_i < workers_count; w_i++) {
+         compact_writers.emplace_back(std::make_unique<CompactWALWriter>());
+      }
+   }
    // -------------------------------------------------------------------------------------
    while (keep_running) {
       io_slot = 0;
@@ -87,7 +95,44 @@ void CRManager::groupCommiter()
             min_all_workers_gsn = std::min<LID>(min_all_workers_gsn, wt_to_lw_copy[w_i].last_gsn);
             min_all_workers_hardened_commit_ts = std::min<TXID>(min_all_workers_hardened_commit_ts, wt_to_lw_copy[w_i].precommitted_tx_commit_ts);
          }
-         if (wt_to_lw_copy[w_i].wal_written_offset > worker.logging.wal_gct_cursor) {
+         if (FLAGS_wal_compact) {
+            if (wt_to_lw_copy[w_i].wal_written_offset != worker.logging.wal_gct_cursor && FLAGS_wal_pwrite) {
+               const u64 chunk_size =
+                   compact_writers[w_i]->encode(w_i, worker.logging.wal_buffer, worker.logging.wal_gct_cursor, wt_to_lw_copy[w_i].wal_written_offset);
+               PARANOID_BLOCK()
+               {
+                  // Round trip the chunk and compare it against the entries it was encoded from
+                  u64 cursor = worker.logging.wal_gct_cursor;
+                  decodeCompactWALChunk(compact_writers[w_i]->data(), [&](const WALEntry& entry) {
+                     const WALEntry* original = reinterpret_cast<const WALEntry*>(worker.logging.wal_buffer + cursor);
+                     if (original->type == WALEntry::TYPE::CARRIAGE_RETURN) {
+                        cursor = 0;
+                        original = reinterpret_cast<const WALEntry*>(worker.logging.wal_buffer);
+                     }
+                     paranoid(entry.type == original->type && entry.size == original->size && entry.lsn == original->lsn);
+                     if (entry.type == WALEntry::TYPE::DT_SPECIFIC) {
+                        const auto& decoded_dt = static_cast<const WALDTEntry&>(entry);
+                        const auto& original_dt = *static_cast<const WALDTEntry*>(original);
+                        paranoid(decoded_dt.gsn == original_dt.gsn && decoded_dt.dt_id == original_dt.dt_id && decoded_dt.pid == original_dt.pid);
+                        paranoid(std::memcmp(decoded_dt.payload, original_dt.payload, entry.size - sizeof(WALDTEntry)) == 0);
+                     }
+                     cursor += entry.size;
+                  });
+                  paranoid(cursor == wt_to_lw_copy[w_i].wal_written_offset);
+               }
+               ssd_offset -= chunk_size;
+               add_pwrite(compact_writers[w_i]->data(), chunk_size, ssd_offset);
+               // -------------------------------------------------------------------------------------
+               COUNTERS_BLOCK()
+               {
+                  const u64 gct_cursor = worker.logging.wal_gct_cursor;
+                  const u64 written_offset = wt_to_lw_copy[w_i].wal_written_offset;
+                  CRCounters::myCounters().gct_write_bytes += chunk_size;
+                  CRCounters::myCounters().gct_raw_bytes +=
+                      (written_offset > gct_cursor) ? written_offset - gct_cursor : FLAGS_wal_buffer_size - gct_cursor + written_offset;
+               }
+            }
+         } else if (wt_to_lw_copy[w_i].wal_written_offset > worker.logging.wal_gct_cursor) {
             const u64 lower_offset = utils::downAlign(worker.logging.wal_gct_cursor);
             const u64 upper_offset = utils::upAlign(wt_to_lw_copy[w_i].wal_written_offset);
             const u64 size_aligned = upper_offset - lower_offset;
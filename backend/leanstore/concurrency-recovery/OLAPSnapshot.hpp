@@ -0,0 +1,40 @@
+#pragma once
+#include "Worker.hpp"
+// -------------------------------------------------------------------------------------
+// -------------------------------------------------------------------------------------
+namespace leanstore
+{
+namespace cr
+{
+// -------------------------------------------------------------------------------------
+// Scoped read-only OLAP transaction for long analytical scans on the calling worker.
+// With --olap_mode the snapshot is published with OLAP_BIT, so it only holds back global_all_lwm:
+// OLTP garbage collection keeps pruning version chains and, with --graveyard, moves removed tuples
+// to the graveyard where OLAP lookups and scans still find them.
+class OLAPSnapshot
+{
+  public:
+   explicit OLAPSnapshot(TX_ISOLATION_LEVEL isolation_level = TX_ISOLATION_LEVEL::SNAPSHOT_ISOLATION)
+   {
+      Worker::my().startTX(TX_MODE::OLAP, isolation_level, true);
+   }
+   ~OLAPSnapshot() { release(); }
+   OLAPSnapshot(const OLAPSnapshot&) = delete;
+   OLAPSnapshot& operator=(const OLAPSnapshot&) = delete;
+   // -------------------------------------------------------------------------------------
+   TXID startTS() const { return activeTX().startTS(); }
+   // Ends the snapshot before the handle goes out of scope
+   void release()
+   {
+      if (active) {
+         active = false;
+         Worker::my().commitTX();
+      }
+   }
+
+  private:
+   bool active = true;
+};
+// -------------------------------------------------------------------------------------
+}  // namespace cr
+}  // namespace leanstore
@@ -18,10 +18,11 @@ struct WALEntry {
    std::atomic<LID> lsn;
    u16 size;
    TYPE type;
-   void computeCRC() { magic_debugging_number = utils::CRC(reinterpret_cast<u8*>(this) + sizeof(u64), size - sizeof(u64)); }
+   // The upper bit of magic_debugging_number marks CRC32C entries, older entries carry the plain CRC-32
+   void computeCRC() { magic_debugging_number = utils::checksum(reinterpret_cast<u8*>(this) + sizeof(u64), size - sizeof(u64)); }
    void checkCRC() const
    {
-      if (magic_debugging_number != utils::CRC(reinterpret_cast<const u8*>(this) + sizeof(u64), size - sizeof(u64))) {
+      if (!utils::verifyChecksum(magic_debugging_number, reinterpret_cast<const u8*>(this) + sizeof(u64), size - sizeof(u64))) {
          raise(SIGTRAP);
          ensure(false);
       }
@@ -56,7 +56,7 @@ Worker::~Worker()
    logging.wal_buffer = nullptr;
 }
 // -------------------------------------------------------------------------------------
-void Worker::startTX(TX_MODE next_tx_type, TX_ISOLATION_LEVEL next_tx_isolation_level, bool read_only)
+void Worker::startTX(TX_MODE next_tx_type, TX_ISOLATION_LEVEL next_tx_isolation_level, bool read_only, TXID snapshot)
 {
    utils::Timer timer(CRCounters::myCounters().cc_ms_start_tx);
    Transaction prev_tx = active_tx;
@@ -99,10 +99,21 @@ void Worker::startTX(TX_MODE next_tx_type, TX_ISOLATION_LEVEL next_tx_isolation_
             cc.switchToSnapshotIsolationMode();
          }
          // -------------------------------------------------------------------------------------
-         {
+         // Back-to-back read-only transactions may keep the previous snapshot for up to si_refresh_rate transactions.
+         // The published snapshot is left untouched, so the versions it needs stay protected from GC
+         ensure(snapshot == 0 || read_only);
+         const bool reuse_snapshot = snapshot == 0 && read_only && FLAGS_si_refresh_rate > 0 && prev_tx.isReadOnly() && prev_tx.state == Transaction::STATE::COMMITTED &&
+                                     prev_tx.current_tx_mode == next_tx_type && prev_tx.current_tx_isolation_level == next_tx_isolation_level &&
+                                     cc.ro_snapshot_reuses < FLAGS_si_refresh_rate;
+         if (reuse_snapshot) {
+           cc.ro_snapshot_reuses++;
+           CRCounters::myCounters().cc_ro_snapshot_reused++;
+         } else {
+           cc.ro_snapshot_reuses = snapshot != 0 ? FLAGS_si_refresh_rate : 0;  // an adopted snapshot is not reused
            utils::Timer timer(CRCounters::myCounters().cc_ms_snapshotting);
            global_workers_current_snapshot[worker_id].store(active_tx.start_ts | LATCH_BIT, std::memory_order_release);
-           active_tx.start_ts = ConcurrencyControl::global_clock.fetch_add(1);
+           // An adopted snapshot stays protected by the transaction that took it, which outlives this one
+           active_tx.start_ts = snapshot != 0 ? snapshot : ConcurrencyControl::global_clock.fetch_add(1);
            if (FLAGS_olap_mode) {
              global_workers_current_snapshot[worker_id].store(active_tx.start_ts | ((active_tx.isOLAP()) ? OLAP_BIT : 0), std::memory_order_release);
            } else {
@@ -139,30 +150,45 @@ void Worker::commitTX()
         logging.rfa_checks_at_precommit.clear();
       }
       // -------------------------------------------------------------------------------------
-      if (activeTX().hasWrote()) {
-        TXID commit_ts = cc.commit_tree.commit(active_tx.startTS());
-        cc.local_latest_write_tx.store(commit_ts, std::memory_order_release);
-        active_tx.commit_ts = commit_ts;
-      }
-      // -------------------------------------------------------------------------------------
       active_tx.max_observed_gsn = logging.wt_gsn_clock;
-      active_tx.state = Transaction::STATE::READY_TO_COMMIT;
-      // -------------------------------------------------------------------------------------
-      WALMetaEntry& entry = logging.reserveWALMetaEntry();
-      entry.type = WALEntry::TYPE::TX_COMMIT;
-      // TODO: commit_ts in log
-      logging.submitWALMetaEntry();
-      if (FLAGS_wal_variant == 2) {
-        logging.wt_to_lw.optimistic_latch.notify_all();
-      }
-      // -------------------------------------------------------------------------------------
-      active_tx.stats.precommit = std::chrono::high_resolution_clock::now();
-      std::unique_lock<std::mutex> g(logging.precommitted_queue_mutex);
-      if (logging.remote_flush_dependency) {  // RFA
-        logging.precommitted_queue.push_back(active_tx);
+      const bool nothing_to_harden = activeTX().isReadOnly() && !activeTX().hasWrote();
+      // Same condition as the group commiter's for the precommitted queue
+      const bool read_flushed = !logging.remote_flush_dependency || (active_tx.max_observed_gsn <= Worker::Logging::global_min_gsn_flushed &&
+                                                                     active_tx.start_ts <= Worker::Logging::global_min_commit_ts_flushed);
+      if (nothing_to_harden && read_flushed) {
+        // Wrote nothing and read nothing unflushed: skip the TX_COMMIT entry and the group commit round trip
+        active_tx.stats.precommit = active_tx.stats.commit = std::chrono::high_resolution_clock::now();
+        active_tx.state = Transaction::STATE::COMMITTED;
+        CRCounters::myCounters().ro_committed_tx++;
       } else {
-        CRCounters::myCounters().rfa_committed_tx++;
-        logging.precommitted_queue_rfa.push_back(active_tx);
+        if (activeTX().hasWrote()) {
+          TXID commit_ts = cc.commit_tree.commit(active_tx.startTS());
+          cc.local_latest_write_tx.store(commit_ts, std::memory_order_release);
+          active_tx.commit_ts = commit_ts;
+        }
+        // -------------------------------------------------------------------------------------
+        active_tx.state = Transaction::STATE::READY_TO_COMMIT;
+        // -------------------------------------------------------------------------------------
+        // A read-only transaction that read unflushed changes of other workers logs nothing, but still waits for the
+        // group commit to flush them
+        if (!nothing_to_harden) {
+          WALMetaEntry& entry = logging.reserveWALMetaEntry();
+          entry.type = WALEntry::TYPE::TX_COMMIT;
+          // TODO: commit_ts in log
+          logging.submitWALMetaEntry();
+          if (FLAGS_wal_variant == 2) {
+            logging.wt_to_lw.optimistic_latch.notify_all();
+          }
+        }
+        // -------------------------------------------------------------------------------------
+        active_tx.stats.precommit = std::chrono::high_resolution_clock::now();
+        std::unique_lock<std::mutex> g(logging.precommitted_queue_mutex);
+        if (logging.remote_flush_dependency) {  // RFA
+          logging.precommitted_queue.push_back(active_tx);
+        } else {
+          CRCounters::myCounters().rfa_committed_tx++;
+          logging.precommitted_queue_rfa.push_back(active_tx);
+        }
       }
     }
     // Only committing snapshot/ changing between SI and lower modes
@@ -192,7 +218,10 @@ void Worker::abortTX()
       leanstore::storage::DTRegistry::global_dt_registry.undo(dt_entry.dt_id, dt_entry.payload, tx_id);
    });
    // -------------------------------------------------------------------------------------
-   cc.history_tree.purgeVersions(worker_id, active_tx.startTS(), active_tx.startTS(), [&](const TXID, const DTID, const u8*, u64, const bool) {});
+   {
+      std::unique_lock<std::mutex> g(cc.gc_mutex);
+      cc.history_tree.purgeVersions(worker_id, active_tx.startTS(), active_tx.startTS(), [&](const TXID, const DTID, const u8*, u64, const bool) {});
+   }
    // -------------------------------------------------------------------------------------
    WALMetaEntry& entry = logging.reserveWALMetaEntry();
    entry.type = WALEntry::TYPE::TX_ABORT;
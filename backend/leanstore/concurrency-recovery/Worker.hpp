@@ -182,6 +182,7 @@ struct Worker {
       atomic<TXID> local_latest_write_tx = 0, local_latest_lwm_for_tx = 0;
       TXID local_all_lwm, local_oltp_lwm;
       TXID local_global_all_lwm_cache = 0;
+      u64 ro_snapshot_reuses = 0;  // Read-only transactions served by the current snapshot
       unique_ptr<TXID[]> local_snapshot_cache;  // = Readview
       unique_ptr<TXID[]> local_snapshot_cache_ts;
       unique_ptr<TXID[]> local_workers_start_ts;
@@ -217,8 +218,14 @@ struct Worker {
       // -------------------------------------------------------------------------------------
       // Clean up state
       u64 cleaned_untill_oltp_lwm = 0;
+      // Versions backlog for the GC service: inserted (by this worker) - inserted as of the last purge that made progress
+      atomic<u64> gc_versions_inserted = 0;
+      u64 gc_versions_purged_mark = 0;
+      std::mutex gc_mutex;  // Serializes purges of this worker's history (GC service vs. abort)
       // -------------------------------------------------------------------------------------
       void garbageCollection();
+      void collectGarbage(WORKERID owner_worker_id);
+      std::pair<TXID, TXID> receivedLWMs();
       void refreshGlobalState();
       void switchToReadCommittedMode();
       void switchToSnapshotIsolationMode();
@@ -236,6 +243,7 @@ struct Worker {
       {
          utils::Timer timer(CRCounters::myCounters().cc_ms_history_tree_insert);
          const u64 new_command_id = (my().command_id++) | ((is_remove) ? TYPE_MSB(COMMANDID) : 0);
+         gc_versions_inserted.store(gc_versions_inserted.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
          history_tree.insertVersion(my().worker_id, my().active_tx.startTS(), new_command_id, dt_id, is_remove, payload_length, cb);
          return new_command_id;
       }
@@ -270,9 +278,11 @@ struct Worker {
   public:
    // -------------------------------------------------------------------------------------
    // TX Control
+   // snapshot: start_ts of a running transaction whose snapshot a read-only transaction reads, 0 for a new one
    void startTX(TX_MODE next_tx_type = TX_MODE::OLTP,
                 TX_ISOLATION_LEVEL next_tx_isolation_level = TX_ISOLATION_LEVEL::SNAPSHOT_ISOLATION,
-                bool read_only = false);
+                bool read_only = false,
+                TXID snapshot = 0);
    void commitTX();
    void abortTX();
    void shutdown();
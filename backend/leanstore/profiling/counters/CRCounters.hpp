@@ -19,15 +19,22 @@ struct CRCounters {
    atomic<u64> gct_phase_2_ms = 0;
    atomic<u64> gct_write_ms = 0;
    atomic<u64> gct_write_bytes = 0;
+   atomic<u64> gct_raw_bytes = 0;  // WAL bytes covered by the written chunks, before compact encoding
    // -------------------------------------------------------------------------------------
    atomic<u64> gct_rounds = 0;
    atomic<u64> gct_committed_tx = 0;
    atomic<u64> rfa_committed_tx = 0;
+   atomic<u64> ro_committed_tx = 0;
    // -------------------------------------------------------------------------------------
    atomic<u64> cc_prepare_igc = 0;
    atomic<u64> cc_cross_workers_visibility_check = 0;
    atomic<u64> cc_versions_space_removed = {0};
    atomic<u64> cc_snapshot_restart = 0;
+   atomic<u64> cc_ro_snapshot_reused = 0;
+   // -------------------------------------------------------------------------------------
+   atomic<u64> gc_service_rounds = 0;
+   atomic<u64> gc_service_purges = 0;  // Worker histories purged
+   atomic<u64> gc_service_backlog = 0;  // Versions waiting at the start of the last round
    // -------------------------------------------------------------------------------------
    // Time
    atomic<u64> cc_ms_snapshotting = 0; // Everything related to commit log
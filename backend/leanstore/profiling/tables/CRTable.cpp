@@ -34,14 +34,18 @@ void CRTable::open()
    columns.emplace("olap_scanned_tuples", [](Column& col) { col << sum(WorkerCounters::worker_counters, &WorkerCounters::olap_scanned_tuples); });
    columns.emplace("olap_tx_abort", [](Column& col) { col << sum(WorkerCounters::worker_counters, &WorkerCounters::olap_tx_abort); });
    columns.emplace("rfa_committed_tx", [&](Column& col) { col << sum(CRCounters::cr_counters, &CRCounters::rfa_committed_tx); });
+   columns.emplace("ro_committed_tx", [&](Column& col) { col << sum(CRCounters::cr_counters, &CRCounters::ro_committed_tx); });
    // -------------------------------------------------------------------------------------
    columns.emplace("cc_snapshot_restart", [](Column& col) { col << sum(CRCounters::cr_counters, &CRCounters::cc_snapshot_restart); });
+   columns.emplace("cc_ro_snapshot_reused", [](Column& col) { col << sum(CRCounters::cr_counters, &CRCounters::cc_ro_snapshot_reused); });
    // -------------------------------------------------------------------------------------
    columns.emplace("wal_read_gib", [&](Column& col) {
       col << (sum(WorkerCounters::worker_counters, &WorkerCounters::wal_read_bytes) * 1.0) / 1024.0 / 1024.0 / 1024.0;
    });
    columns.emplace("gct_write_gib",
                    [&](Column& col) { col << (sum(CRCounters::cr_counters, &CRCounters::gct_write_bytes) * 1.0) / 1024.0 / 1024.0 / 1024.0; });
+   columns.emplace("gct_raw_gib",
+                   [&](Column& col) { col << (sum(CRCounters::cr_counters, &CRCounters::gct_raw_bytes) * 1.0) / 1024.0 / 1024.0 / 1024.0; });
    columns.emplace("wal_write_gib", [&](Column& col) {
       col << (sum(WorkerCounters::worker_counters, &WorkerCounters::wal_write_bytes) * 1.0) / 1024.0 / 1024.0 / 1024.0;
    });
@@ -55,6 +59,9 @@ void CRTable::open()
    columns.emplace("cc_cross_workers_visibility_check",
                    [&](Column& col) { col << sum(CRCounters::cr_counters, &CRCounters::cc_cross_workers_visibility_check); });
    columns.emplace("cc_versions_space_removed", [&](Column& col) { col << sum(CRCounters::cr_counters, &CRCounters::cc_versions_space_removed); });
+   columns.emplace("gc_service_rounds", [&](Column& col) { col << sum(CRCounters::cr_counters, &CRCounters::gc_service_rounds); });
+   columns.emplace("gc_service_purges", [&](Column& col) { col << sum(CRCounters::cr_counters, &CRCounters::gc_service_purges); });
+   columns.emplace("gc_service_backlog", [&](Column& col) { col << sum(CRCounters::cr_counters, &CRCounters::gc_service_backlog); });
    // -------------------------------------------------------------------------------------
    columns.emplace("cc_ms_oltp_tx", [&](Column& col) { col << sum(CRCounters::cr_counters, &CRCounters::cc_ms_oltp_tx); });
    columns.emplace("cc_ms_olap_tx", [&](Column& col) { col << sum(CRCounters::cr_counters, &CRCounters::cc_ms_olap_tx); });
@@ -65,6 +65,7 @@ void ConfigsTable::open()
    columns.emplace("c_pgc", [&](Column& col) { col << FLAGS_pgc; });
    columns.emplace("c_isolation_level", [&](Column& col) { col << FLAGS_isolation_level; });
    columns.emplace("c_olap_mode", [&](Column& col) { col << FLAGS_olap_mode; });
+   columns.emplace("c_gc_service", [&](Column& col) { col << FLAGS_gc_service; });
    columns.emplace("c_graveyard", [&](Column& col) { col << FLAGS_graveyard; });
    columns.emplace("c_history_tree_inserts", [&](Column& col) { col << FLAGS_history_tree_inserts; });
    // -------------------------------------------------------------------------------------
@@ -262,6 +262,13 @@ class BTreeVI : public BTreeLL
 
   public:
    BTreeLL* graveyard;
+   // -------------------------------------------------------------------------------------
+   // Resolves a raw leaf entry (e.g., under a BTreeSharedIterator of this tree or of its graveyard)
+   // to the version visible to the active transaction
+   OP_RESULT readVisible(Slice key, Slice payload, std::function<void(Slice value)> callback)
+   {
+      return std::get<0>(reconstructTuple(key, payload, callback));
+   }
 
   private:
    // -------------------------------------------------------------------------------------
@@ -457,7 +464,7 @@ class BTreeVI : public BTreeLL
                   if (primary_version.is_removed) {
                      jumpmu_return{OP_RESULT::NOT_FOUND, 1};
                   }
-                  callback(Slice(primary_version.payload, payload.length()));
+                  callback(Slice(primary_version.payload, payload.length() - sizeof(ChainedTuple)));
                   jumpmu_return{OP_RESULT::OK, 1};
                } else {
                   if (primary_version.isFinal()) {
@@ -344,7 +344,7 @@ BufferFrame& BufferManager::resolveSwip(Guard& swip_guard, Swip<BufferFrame>& sw
       bf.header.state = BufferFrame::STATE::LOADED;
       bf.header.pid = pid;
       if (FLAGS_crc_check) {
-         bf.header.crc = utils::CRC(bf.page.dt, EFFECTIVE_PAGE_SIZE);
+         bf.header.crc = utils::checksum(bf.page.dt, EFFECTIVE_PAGE_SIZE);
       }
       // -------------------------------------------------------------------------------------
       jumpmuTry()
@@ -185,7 +185,7 @@ void BufferManager::pageProviderThread(u64 p_begin, u64 p_end)  // [p_begin, p_e
          c_guard.guard.toExclusive();
          // -------------------------------------------------------------------------------------
          if (FLAGS_crc_check && bf.header.crc) {
-            ensure(utils::CRC(bf.page.dt, EFFECTIVE_PAGE_SIZE) == bf.header.crc);
+            ensure(utils::verifyChecksum(bf.header.crc, bf.page.dt, EFFECTIVE_PAGE_SIZE));
          }
          // -------------------------------------------------------------------------------------
          ensure(!bf.isDirty());
@@ -245,7 +245,7 @@ void BufferManager::pageProviderThread(u64 p_begin, u64 p_end)  // [p_begin, p_e
                      paranoid(!cooled_bf->header.is_being_written_back);
                      cooled_bf->header.is_being_written_back.store(true, std::memory_order_release);
                      if (FLAGS_crc_check) {
-                        cooled_bf->header.crc = utils::CRC(cooled_bf->page.dt, EFFECTIVE_PAGE_SIZE);
+                        cooled_bf->header.crc = utils::checksum(cooled_bf->page.dt, EFFECTIVE_PAGE_SIZE);
                      }
                      // TODO: preEviction callback according to DTID
                      PID wb_pid = cooled_bf_pid;
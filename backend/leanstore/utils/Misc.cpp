@@ -6,8 +6,12 @@
 #include "CRC.hpp"
 // -------------------------------------------------------------------------------------
 #include <execinfo.h>
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
 
 #include <atomic>
+#include <cstring>
 // -------------------------------------------------------------------------------------
 namespace leanstore
 {
@@ -79,5 +83,63 @@ u32 CRC(const u8* src, u64 size)
    return CRC::Calculate(src, size, CRC::CRC_32());
 }
 // -------------------------------------------------------------------------------------
+namespace
+{
+u32 softwareCRC32C(const u8* src, u64 size)
+{
+   // Castagnoli polynomial, reflected, same parameters as the crc32 instruction
+   static const CRC::Parameters<crcpp_uint32, 32> parameters = {0x1EDC6F41, 0xFFFFFFFF, 0xFFFFFFFF, true, true};
+   static const CRC::Table<crcpp_uint32, 32> table(parameters);
+   return CRC::Calculate(src, size, table);
+}
+// -------------------------------------------------------------------------------------
+#if defined(__x86_64__)
+__attribute__((target("sse4.2"))) u32 hardwareCRC32C(const u8* src, u64 size)
+{
+   u64 crc = 0xFFFFFFFF;
+   for (; size >= sizeof(u64); size -= sizeof(u64), src += sizeof(u64)) {
+      u64 word;
+      std::memcpy(&word, src, sizeof(u64));
+      crc = _mm_crc32_u64(crc, word);
+   }
+   u32 crc32 = static_cast<u32>(crc);
+   for (; size > 0; size--, src++) {
+      crc32 = _mm_crc32_u8(crc32, *src);
+   }
+   return ~crc32;
+}
+// -------------------------------------------------------------------------------------
+using CRC32CFunc = u32 (*)(const u8*, u64);
+CRC32CFunc resolveCRC32C()
+{
+   static const CRC32CFunc impl = []() {
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("sse4.2") ? hardwareCRC32C : softwareCRC32C;
+   }();
+   return impl;
+}
+#else
+using CRC32CFunc = u32 (*)(const u8*, u64);
+CRC32CFunc resolveCRC32C()
+{
+   return softwareCRC32C;
+}
+#endif
+}  // namespace
+// -------------------------------------------------------------------------------------
+u32 CRC32C(const u8* src, u64 size)
+{
+   return resolveCRC32C()(src, size);
+}
+// -------------------------------------------------------------------------------------
+bool hasHardwareCRC32C()
+{
+#if defined(__x86_64__)
+   return resolveCRC32C() == hardwareCRC32C;
+#else
+   return false;
+#endif
+}
+// -------------------------------------------------------------------------------------
 }  // namespace utils
 }  // namespace leanstore
@@ -33,6 +33,20 @@ inline u64 downAlign(u64 x)
 }
 // -------------------------------------------------------------------------------------
 u32 CRC(const u8* src, u64 size);
+// CRC32C (Castagnoli) uses the SSE4.2 crc32 instruction when the CPU has it and a table-driven fallback otherwise
+u32 CRC32C(const u8* src, u64 size);
+bool hasHardwareCRC32C();
+// -------------------------------------------------------------------------------------
+// Stored checksums carry a format bit so that readers can tell CRC32C apart from the legacy CRC-32
+constexpr u64 CRC32C_FORMAT_BIT = u64(1) << 63;
+inline u64 checksum(const u8* src, u64 size)
+{
+   return CRC32C_FORMAT_BIT | CRC32C(src, size);
+}
+inline bool verifyChecksum(u64 stored, const u8* src, u64 size)
+{
+   return stored == ((stored & CRC32C_FORMAT_BIT) ? checksum(src, size) : CRC(src, size));
+}
 // -------------------------------------------------------------------------------------
 // Fold functions convert integers to a lexicographical comparable format
 inline u64 fold(u8* writer, const u64& x)
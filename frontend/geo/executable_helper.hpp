@@ -7,7 +7,9 @@
 #include <thread>
 #include "../shared/RocksDB.hpp"
 #include "../shared/logger/logger.hpp"
+#include "../shared/tx_hooks.hpp"
 #include "leanstore/concurrency-recovery/CRMG.hpp"
+#include "leanstore/concurrency-recovery/OLAPSnapshot.hpp"
 #include "tpch_workload.hpp"
 
 DECLARE_int32(storage_structure);
@@ -18,8 +20,14 @@ DEFINE_bool(log_progress, true, "Log progress of the workload execution");
 static constexpr u64 BG_WORKER = 0;
 static constexpr u64 MAIN_WORKER = 1;
 
+enum class TxKind { READ_WRITE, READ_ONLY, OLAP };
+
 struct DBTraits {
    virtual void run_tx(std::function<void()> cb, u64 worker_id = MAIN_WORKER) = 0;
+   // For transactions that never write; backends without a cheaper path run them as regular transactions
+   virtual void run_read_only_tx(std::function<void()> cb, u64 worker_id = MAIN_WORKER) { run_tx(cb, worker_id); }
+   // For long read-only scans that should not hold back garbage collection of concurrent updates
+   virtual void run_olap_tx(std::function<void()> cb, u64 worker_id = MAIN_WORKER) { run_read_only_tx(cb, worker_id); }
    virtual void run_tx_w_rollback(std::function<void()> cb, std::string tx, u64 worker_id = MAIN_WORKER)
    {
       jumpmuTry()
@@ -45,9 +53,39 @@ struct LeanStoreTraits : public DBTraits {
    void run_tx(std::function<void()> cb, u64 worker_id)
    {
       crm.scheduleJobSync(worker_id, [&]() {
+         TxHooks::begin();
          leanstore::cr::Worker::my().startTX(leanstore::TX_MODE::OLTP, leanstore::TX_ISOLATION_LEVEL::SERIALIZABLE);
+         TxHooks::started(leanstore::cr::Worker::my().cc.ro_snapshot_reuses > 0);
          cb();
          leanstore::cr::Worker::my().commitTX();
+         TxHooks::committed();
+      });
+   }
+
+   // No commit log entry, no group commit, and the snapshot may be reused (--si_refresh_rate)
+   void run_read_only_tx(std::function<void()> cb, u64 worker_id)
+   {
+      crm.scheduleJobSync(worker_id, [&]() {
+         TxHooks::begin();
+         leanstore::cr::Worker::my().startTX(leanstore::TX_MODE::OLTP, leanstore::TX_ISOLATION_LEVEL::SERIALIZABLE, true);
+         TxHooks::started(leanstore::cr::Worker::my().cc.ro_snapshot_reuses > 0);
+         cb();
+         leanstore::cr::Worker::my().commitTX();
+         TxHooks::committed();
+      });
+   }
+
+   // OLAP snapshot: only holds back the OLAP low-water mark with --olap_mode (see cr::OLAPSnapshot)
+   void run_olap_tx(std::function<void()> cb, u64 worker_id)
+   {
+      crm.scheduleJobSync(worker_id, [&]() {
+         TxHooks::begin();
+         {
+            leanstore::cr::OLAPSnapshot snapshot(leanstore::TX_ISOLATION_LEVEL::SERIALIZABLE);
+            TxHooks::started(false);
+            cb();
+         }
+         TxHooks::committed();
       });
    }
 
@@ -56,7 +94,11 @@ struct LeanStoreTraits : public DBTraits {
       crm.scheduleJobSync(worker_id, [&]() { leanstore::cr::Worker::my().shutdown(); });
    }
 
-   void rollback_tx(u64) {}
+   // The worker already rolled back; its abort hooks run on the worker that ran the transaction
+   void rollback_tx(u64 worker_id)
+   {
+      crm.scheduleJobSync(worker_id, []() { TxHooks::aborted(); });
+   }
 
    std::string name() { return "LeanStore"; }
 };
@@ -67,15 +109,22 @@ struct RocksDBTraits : public DBTraits {
    ~RocksDBTraits() = default;
    void run_tx(std::function<void()> cb, u64)  // worker id determined by caller thread
    {
+      TxHooks::begin();
       rocks_db.startTX();
+      TxHooks::started(false);
       cb();
       rocks_db.commitTX();
+      TxHooks::committed();
    }
    void cleanup_thread(u64)
    {  // No cleanup needed for RocksDB threads
    }
 
-   void rollback_tx(u64) { rocks_db.rollbackTX(); }
+   void rollback_tx(u64)
+   {
+      rocks_db.rollbackTX();
+      TxHooks::aborted();
+   }
    std::string name() { return "RocksDB"; }
 };
 
@@ -122,17 +171,17 @@ struct ExecutableHelper {
 
       schedule_bg_txs();
 
-      tput_tx(std::bind(&PerStructureWorkloadFull::join_n, workload.get()), "join-n");
-      tput_tx(std::bind(&PerStructureWorkloadFull::join_ns, workload.get()), "join-ns");
-      tput_tx(std::bind(&PerStructureWorkloadFull::join_nsc, workload.get()), "join-nsc");
+      tput_tx(std::bind(&PerStructureWorkloadFull::join_n, workload.get()), "join-n", TxKind::OLAP);
+      tput_tx(std::bind(&PerStructureWorkloadFull::join_ns, workload.get()), "join-ns", TxKind::READ_ONLY);
+      tput_tx(std::bind(&PerStructureWorkloadFull::join_nsc, workload.get()), "join-nsc", TxKind::READ_ONLY);
 
-      tput_tx(std::bind(&PerStructureWorkloadFull::mixed_n, workload.get()), "mixed-n");
-      tput_tx(std::bind(&PerStructureWorkloadFull::mixed_ns, workload.get()), "mixed-ns");
-      tput_tx(std::bind(&PerStructureWorkloadFull::mixed_nsc, workload.get()), "mixed-nsc");
+      tput_tx(std::bind(&PerStructureWorkloadFull::mixed_n, workload.get()), "mixed-n", TxKind::OLAP);
+      tput_tx(std::bind(&PerStructureWorkloadFull::mixed_ns, workload.get()), "mixed-ns", TxKind::READ_ONLY);
+      tput_tx(std::bind(&PerStructureWorkloadFull::mixed_nsc, workload.get()), "mixed-nsc", TxKind::READ_ONLY);
 
-      tput_tx(std::bind(&PerStructureWorkloadFull::distinct_n, workload.get()), "distinct-n");
-      tput_tx(std::bind(&PerStructureWorkloadFull::distinct_ns, workload.get()), "distinct-ns");
-      tput_tx(std::bind(&PerStructureWorkloadFull::distinct_nsc, workload.get()), "distinct-nsc");
+      tput_tx(std::bind(&PerStructureWorkloadFull::distinct_n, workload.get()), "distinct-n", TxKind::OLAP);
+      tput_tx(std::bind(&PerStructureWorkloadFull::distinct_ns, workload.get()), "distinct-ns", TxKind::READ_ONLY);
+      tput_tx(std::bind(&PerStructureWorkloadFull::distinct_nsc, workload.get()), "distinct-nsc", TxKind::READ_ONLY);
 
       keep_running_bg_tx = false;
       // wait for background thread to finish
@@ -165,6 +214,7 @@ struct ExecutableHelper {
          long long bg_insert_count = 0;
          long long bg_erase_count = 0;
          long long bg_lookup_count = 0;
+         long long bg_fold_count = 0;
          std::function<void()> periodic_reset = [&]() {
             // start time
             auto start = std::chrono::system_clock::now();
@@ -183,24 +233,30 @@ struct ExecutableHelper {
                if (run_main_thread == false) {
                   periodic_reset();
                }
-               if (lottery < FLAGS_bgw_pct) {
-                  if ((lottery < FLAGS_bgw_pct / 2 && customer_to_erase) ||  // half of the time erase if we have customers to erase
-                      workload->insertion_complete()) {                      // or when insertion needs to be reset
-                     db_traits->run_tx([&]() { customer_to_erase = workload->erase1(); }, BG_WORKER);
-                     tx_type = "erase";
-                     bg_erase_count++;
+               if (workload->view_deltas_due()) {  // pending view maintenance runs in between the other bg txs
+                  tx_type = "fold";  // maintenance, not part of the bg workload mix, so it does not count into bg_tx_count
+                  db_traits->run_tx(std::bind(&PerStructureWorkloadFull::fold_view_deltas, workload.get()), BG_WORKER);
+                  bg_fold_count++;
+               } else {
+                  if (lottery < FLAGS_bgw_pct) {
+                     if ((lottery < FLAGS_bgw_pct / 2 && customer_to_erase) ||  // half of the time erase if we have customers to erase
+                         workload->insertion_complete()) {                      // or when insertion needs to be reset
+                        db_traits->run_tx([&]() { customer_to_erase = workload->erase1(); }, BG_WORKER);
+                        tx_type = "erase";
+                        bg_erase_count++;
+                     } else {
+                        db_traits->run_tx(std::bind(&PerStructureWorkloadFull::insert1, workload.get()), BG_WORKER);
+                        tx_type = "update";
+                        customer_to_erase = true;
+                        bg_insert_count++;
+                     }
                   } else {
-                     db_traits->run_tx(std::bind(&PerStructureWorkloadFull::insert1, workload.get()), BG_WORKER);
-                     tx_type = "update";
-                     customer_to_erase = true;
-                     bg_insert_count++;
+                     db_traits->run_read_only_tx(std::bind(&PerStructureWorkloadFull::bg_lookup, workload.get()), BG_WORKER);
+                     tx_type = "lookup";
+                     bg_lookup_count++;
                   }
-               } else {
-                  db_traits->run_tx(std::bind(&PerStructureWorkloadFull::bg_lookup, workload.get()), BG_WORKER);
-                  tx_type = "lookup";
-                  bg_lookup_count++;
+                  bg_tx_count++;
                }
-               bg_tx_count++;
             }
             jumpmuCatchNoPrint()
             {
@@ -213,7 +269,7 @@ struct ExecutableHelper {
          periodic_reset();
 
          std::cout << "#" << bg_tx_count.load() << " bg tx in total performed. " << bg_insert_count << " inserts, " << bg_erase_count << " erases, "
-                   << bg_lookup_count << " lookups." << std::endl;
+                   << bg_lookup_count << " lookups, " << bg_fold_count << " view delta folds." << std::endl;
          db_traits->cleanup_thread(BG_WORKER);
          running_threads_counter--;
       }).detach();
@@ -231,7 +287,7 @@ struct ExecutableHelper {
       return ret;
    }
 
-   void tput_tx(std::function<void()> cb, std::string tx)
+   void tput_tx(std::function<void()> cb, std::string tx, TxKind kind = TxKind::READ_WRITE)
    {
       while (!run_main_thread) {
       }
@@ -253,7 +309,17 @@ struct ExecutableHelper {
       while (keep_running_condition(keep_running_tx.load(), tx)) {
          jumpmuTry()
          {
-            db_traits->run_tx(cb);
+            switch (kind) {
+               case TxKind::READ_WRITE:
+                  db_traits->run_tx(cb);
+                  break;
+               case TxKind::READ_ONLY:
+                  db_traits->run_read_only_tx(cb);
+                  break;
+               case TxKind::OLAP:
+                  db_traits->run_olap_tx(cb);
+                  break;
+            }
             count++;
          }
          jumpmuCatchNoPrint()
@@ -271,6 +337,7 @@ struct ExecutableHelper {
       auto end = std::chrono::high_resolution_clock::now();
       long duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
       double tput = (double)count.load() / duration * 1e6;
+      tpch.logger.set_counters(workload->take_counters());
       tpch.logger.log(tput, count.load(), tx, workload->get_name(), workload->get_size());
       running_threads_counter--;
       run_main_thread = false;
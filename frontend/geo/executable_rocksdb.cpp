@@ -17,10 +17,22 @@ DEFINE_int32(tx_seconds, 15, "Number of seconds to run each type of transactions
 DEFINE_int32(
     storage_structure,
     0,
-    "Storage structure: 0 to force reload, 1 for traditional indexes, 2 for materialized views, 3 for merged indexes, 4 for 2 merged indexes");
+    "Storage structure: 0 to force reload, 1 for traditional indexes, 2 for materialized views, 3 for merged indexes, 4 for hash joins, "
+    "5 for parallel hash joins, 6 to route each query to one of 1-4 by cost");
 DEFINE_int32(warmup_seconds, 0, "Warmup seconds");                                     // flush out loading data from the buffer pool
 DEFINE_int32(tentative_skip_bytes, 12288, "Tentative skip bytes for smart skipping");  // empirical optimal value
+DEFINE_bool(adaptive_premerged_join, false, "Let PremergedJoin choose between seeking and scanning from learned costs");
 DEFINE_int32(bgw_pct, 10, "Percentage of writes in background transactions (0-100)");
+DEFINE_int32(parallel_join_workers, 0, "Jobs for the parallel hash join, 0 for the main worker plus every worker after it");
+DEFINE_bool(semi_join_filter, false, "Push Bloom filters of the smaller join inputs into the scanners of the larger ones");
+DEFINE_bool(approx_distinct, false, "Approximate COUNT(DISTINCT) with HyperLogLog");
+DEFINE_int32(maintenance_batch, 0, "Customer changes buffered per view maintenance epoch and applied in key order, 0 to apply each at once");
+DEFINE_bool(deferred_view_maintenance, false, "Keep join_view and cust_count_view changes in memory, merge them into view queries and fold them in later");
+DEFINE_int32(view_delta_max_rows, 10000, "Pending view changes that trigger a fold with --deferred_view_maintenance");
+DEFINE_int32(view_delta_max_staleness_ms, 1000, "Age of the oldest pending view change that triggers a fold with --deferred_view_maintenance");
+DEFINE_int32(result_cache_entries, 0, "Query results cached by query kind and selection, invalidated by customer changes, 0 to disable");
+DEFINE_int32(merged_partitions, 1, "B-trees the merged index is range-partitioned into by nationkey (LeanStore only)");
+DEFINE_bool(multiway_merge_join, false, "Join the base tables of range_query_by_base with one k-way merge join instead of a chain of binary ones");
 
 using namespace geo_join;
 
@@ -29,6 +41,8 @@ using BaseWorkload = PerStructureWorkload<BaseGeoJoin<RocksDBAdapter, RocksDBMer
 using ViewWorkload = PerStructureWorkload<ViewGeoJoin<RocksDBAdapter, RocksDBMergedAdapter, RocksDBScanner, RocksDBMergedScanner>>;
 using MergedWorkload = PerStructureWorkload<MergedGeoJoin<RocksDBAdapter, RocksDBMergedAdapter, RocksDBScanner, RocksDBMergedScanner>>;
 using HashWorkload = PerStructureWorkload<HashGeoJoin<RocksDBAdapter, RocksDBMergedAdapter, RocksDBScanner, RocksDBMergedScanner>>;
+using ParallelHashWorkload = PerStructureWorkload<ParallelHashGeoJoin<RocksDBAdapter, RocksDBMergedAdapter, RocksDBScanner, RocksDBMergedScanner>>;
+using RoutedWorkload = PerStructureWorkload<RoutedGeoJoin<RocksDBAdapter, RocksDBMergedAdapter, RocksDBScanner, RocksDBMergedScanner>>;
 
 thread_local rocksdb::Transaction* RocksDB::txn = nullptr;
 
@@ -61,7 +75,7 @@ int main(int argc, char** argv)
    RocksDBAdapter<nscci_t> geo_view(rocks_db);
    RocksDBAdapter<customer_count_t> cust_count_view(rocks_db);
    RocksDBAdapter<view_t> view(rocks_db);
-   RocksDBMergedAdapter<nation2_t, states_t, county_t, city_t, customer2_t> mergedGeoJoin(rocks_db);
+   GeoPath::MergedIndex<RocksDBMergedAdapter> mergedGeoJoin(rocks_db);
    // -------------------------------------------------------------------------------------
    rocks_db.open();  // only after all adapters are created (along with their column families)
 
@@ -108,6 +122,20 @@ int main(int argc, char** argv)
          helper.run();
          break;
       }
+      case 5: {
+         auto parallel_hash_workload = std::make_unique<ParallelHashWorkload>(tpchGeoJoin, "parallel_hash");
+         using EH = ExecutableHelper<ParallelHashWorkload, RocksDBAdapter, RocksDBMergedAdapter, RocksDBScanner, RocksDBMergedScanner>;
+         EH helper(rocks_db, std::unique_ptr(std::move(parallel_hash_workload)), tpch);
+         helper.run();
+         break;
+      }
+      case 6: {
+         auto routed_workload = std::make_unique<RoutedWorkload>(tpchGeoJoin, "routed");
+         using EH = ExecutableHelper<RoutedWorkload, RocksDBAdapter, RocksDBMergedAdapter, RocksDBScanner, RocksDBMergedScanner>;
+         EH helper(rocks_db, std::unique_ptr(std::move(routed_workload)), tpch);
+         helper.run();
+         break;
+      }
       default: {
          std::cerr << "Invalid storage structure option: " << FLAGS_storage_structure << std::endl;
          return -1;
@@ -1,41 +1,70 @@
 #pragma once
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstddef>
+#include <mutex>
+#include <optional>
 
 #include "../shared/merge-join/binary_merge_join.hpp"
+#include "../shared/merge-join/fused_join.hpp"
 #include "../shared/merge-join/hash_join.hpp"
+#include "../shared/merge-join/multi_table_merge_join.hpp"
 #include "../shared/merge-join/premerged_join.hpp"
+#include "../shared/merge-join/radix_hash_join.hpp"
+#include "../shared/parallel_jobs.hpp"
 #include "views.hpp"
 #include "workload.hpp"
 
+DECLARE_int32(parallel_join_workers);
+DECLARE_bool(multiway_merge_join);
+
 inline void update_sk(sort_key_t& sk, const sort_key_t& found_k)
 {
-   if (sk.nationkey != 0)
-      sk.nationkey = found_k.nationkey;
-   if (sk.statekey != 0)
-      sk.statekey = found_k.statekey;
-   if (sk.countykey != 0)
-      sk.countykey = found_k.countykey;
-   if (sk.citykey != 0)
-      sk.citykey = found_k.citykey;
-   if (sk.custkey != 0)
-      sk.custkey = found_k.custkey;
+   sort_key_t::hierarchy::fill_selected(sk, found_k);
+}
+
+// past_end of a scanFiltered over entries keyed by a JK, such as join_view: the first entry extends sk like update_sk,
+// the others are compared with it as folded bytes
+inline auto past_selection(sort_key_t& sk)
+{
+   return [&sk, end = std::optional<FoldedJK<sort_key_t>>()](const u8* key, u16 key_length) mutable {
+      if (!end.has_value()) {
+         sort_key_t first;
+         sort_key_t::keyunfold(key, first);
+         update_sk(sk, first);
+         end.emplace(sk);
+      }
+      if (end->exact) {
+         return end->compare(key, key_length) > 0;
+      }
+      sort_key_t jk;
+      sort_key_t::keyunfold(key, jk);
+      return jk.match(sk) != 0;
+   };
 }
 
 namespace geo_join
 {
 template <template <typename> class AdapterType, template <typename> class ScannerType>
 struct BaseJoiner {
+   // Cities of the range, pushed into customer2_scanner with --semi_join_filter; declared first so that it
+   // outlives the scanner
+   std::optional<SemiJoinFilter<sort_key_t>> city_filter;
    std::unique_ptr<ScannerType<nation2_t>> nation_scanner;
    std::unique_ptr<ScannerType<states_t>> states_scanner;
    std::unique_ptr<ScannerType<county_t>> county_scanner;
    std::unique_ptr<ScannerType<city_t>> city_scanner;
    std::unique_ptr<ScannerType<customer2_t>> customer2_scanner;
 
-   std::optional<BinaryMergeJoin<sort_key_t, ns_t, nation2_t, states_t>> joiner_ns;
-   std::optional<BinaryMergeJoin<sort_key_t, nsc_t, ns_t, county_t>> joiner_nsc;
-   std::optional<BinaryMergeJoin<sort_key_t, nscci_t, nsc_t, city_t>> joiner_nscci;
-   std::optional<BinaryMergeJoin<sort_key_t, view_t, nscci_t, customer2_t>> final_joiner;
+   using JoinerNS = FusedMergeJoin<sort_key_t, ns_t, ScannerType<nation2_t>, ScannerType<states_t>>;
+   using JoinerNSC = FusedMergeJoin<sort_key_t, nsc_t, JoinerNS, ScannerType<county_t>>;
+   using JoinerNSCCI = FusedMergeJoin<sort_key_t, nscci_t, JoinerNSC, ScannerType<city_t>>;
+   using FinalJoiner = FusedMergeJoin<sort_key_t, view_t, JoinerNSCCI, ScannerType<customer2_t>>;
+   std::optional<JoinerNS> joiner_ns;
+   std::optional<JoinerNSC> joiner_nsc;
+   std::optional<JoinerNSCCI> joiner_nscci;
+   std::optional<FinalJoiner> final_joiner;
 
    BaseJoiner(AdapterType<nation2_t>& nation,
               AdapterType<states_t>& states,
@@ -52,10 +81,13 @@ struct BaseJoiner {
       if (seek_key != sort_key_t::max()) {
          seek(seek_key);
       }
-      joiner_ns.emplace([this]() { return nation_scanner->next(); }, [this]() { return states_scanner->next(); });
-      joiner_nsc.emplace([this]() { return joiner_ns->next(); }, [this]() { return county_scanner->next(); });
-      joiner_nscci.emplace([this]() { return joiner_nsc->next(); }, [this]() { return city_scanner->next(); });
-      final_joiner.emplace([this]() { return joiner_nscci->next(); }, [this]() { return customer2_scanner->next(); });
+      if (FLAGS_semi_join_filter) {
+         build_city_filter(city, seek_key);
+      }
+      joiner_ns.emplace(*nation_scanner, *states_scanner);
+      joiner_nsc.emplace(*joiner_ns, *county_scanner);
+      joiner_nscci.emplace(*joiner_nsc, *city_scanner);
+      final_joiner.emplace(*joiner_nscci, *customer2_scanner);
 
       auto first_ret = final_joiner->next();
       if (first_ret.has_value()) {
@@ -75,6 +107,28 @@ struct BaseJoiner {
 
    long produced() const { return final_joiner->produced(); }
 
+   // The customers of cities that are not in the range are skipped by the scanner before the merge
+   void build_city_filter(AdapterType<city_t>& city, const sort_key_t& seek_key)
+   {
+      std::vector<sort_key_t> city_jks;
+      city.scan(
+          seek_key == sort_key_t::max() ? city_t::Key{0, 0, 0, 0} : city_t::Key{seek_key},
+          [&](const city_t::Key& k, const city_t& v) {
+             sort_key_t jk = SKBuilder<sort_key_t>::create(k, v);
+             if (seek_key != sort_key_t::max() && jk.match(seek_key) != 0) {
+                return false;
+             }
+             city_jks.push_back(jk);
+             return true;
+          },
+          []() {});
+      city_filter.emplace(city_jks.size());
+      for (const auto& jk : city_jks) {
+         city_filter->insert(jk);
+      }
+      customer2_scanner->set_filter(city_filter->template probe_predicate<city_t, customer2_t>(seek_key));
+   }
+
    void seek(const sort_key_t& sk)
    {
       auto n_ret = nation_scanner->seek(nation2_t::Key{sk});
@@ -82,13 +136,85 @@ struct BaseJoiner {
       auto c_ret = county_scanner->seek(county_t::Key{sk});
       auto ci_ret = city_scanner->seek(city_t::Key{sk});
       auto cu_ret = customer2_scanner->seek(customer2_t::Key{sk});
-      if ((!n_ret || !s_ret || !c_ret || !ci_ret || !cu_ret) && sk.nationkey != 25) {  // HARDCODED max nationkey
+      // near the end of the tables the deeper levels run out first, e.g. within the last nation; only a level that
+      // fails while a deeper one is found is unexpected
+      const std::array<bool, GeoPath::depth> found{n_ret, s_ret, c_ret, ci_ret, cu_ret};
+      const auto deepest_found = std::find(found.rbegin(), found.rend(), true);
+      if (std::find(deepest_found, found.rend(), false) != found.rend()) {
          std::cerr << "WARNING: BaseJoiner::seek() failed to seek to " << sk << "nation: " << n_ret << ", states: " << s_ret << ", county: " << c_ret
                    << ", city: " << ci_ret << ", customer2: " << cu_ret << std::endl;
       }
    }
 };
 
+// The base tables joined by one k-way MergeJoin over all five scanners instead of BaseJoiner's chain of binary joins
+// (--multiway_merge_join). The range is fixed by the first joined record like in BaseJoiner; from then on the scanners
+// stop at its end
+template <template <typename> class AdapterType, template <typename> class ScannerType>
+struct MultiwayBaseJoiner {
+   std::unique_ptr<ScannerType<nation2_t>> nation_scanner;
+   std::unique_ptr<ScannerType<states_t>> states_scanner;
+   std::unique_ptr<ScannerType<county_t>> county_scanner;
+   std::unique_ptr<ScannerType<city_t>> city_scanner;
+   std::unique_ptr<ScannerType<customer2_t>> customer2_scanner;
+
+   using Joiner = MergeJoin<sort_key_t, view_t, nation2_t, states_t, county_t, city_t, customer2_t>;
+   std::optional<Joiner> joiner;
+   sort_key_t seek_key;
+   bool bounded = false;
+
+   MultiwayBaseJoiner(AdapterType<nation2_t>& nation,
+                      AdapterType<states_t>& states,
+                      AdapterType<county_t>& county,
+                      AdapterType<city_t>& city,
+                      AdapterType<customer2_t>& customer2,
+                      sort_key_t seek_key)
+       : nation_scanner(nation.getScanner()),
+         states_scanner(states.getScanner()),
+         county_scanner(county.getScanner()),
+         city_scanner(city.getScanner()),
+         customer2_scanner(customer2.getScanner()),
+         seek_key(seek_key)
+   {
+      nation_scanner->seek(nation2_t::Key{seek_key});
+      states_scanner->seek(states_t::Key{seek_key});
+      county_scanner->seek(county_t::Key{seek_key});
+      city_scanner->seek(city_t::Key{seek_key});
+      customer2_scanner->seek(customer2_t::Key{seek_key});
+      joiner.emplace(typename Joiner::Sources{bounded_source(*nation_scanner), bounded_source(*states_scanner), bounded_source(*county_scanner),
+                                              bounded_source(*city_scanner), bounded_source(*customer2_scanner)});
+   }
+
+   // Joined records of the range
+   long run()
+   {
+      auto kv = joiner->next();
+      if (!kv.has_value()) {
+         return 0;
+      }
+      update_sk(seek_key, kv->first.jk);
+      bounded = true;
+      long produced = 0;
+      for (; kv.has_value() && kv->first.jk.match(seek_key) == 0; kv = joiner->next()) {
+         produced++;
+      }
+      return produced;
+   }
+
+  private:
+   template <typename Scanner>
+   auto bounded_source(Scanner& scanner)
+   {
+      return [this, &scanner]() {
+         auto kv = scanner.next();
+         if (kv.has_value() && bounded && SKBuilder<sort_key_t>::create(kv->first, kv->second).match(seek_key) > 0) {
+            kv.reset();
+         }
+         return kv;
+      };
+   }
+};
+
 template <template <typename> class AdapterType, template <typename> class ScannerType>
 struct HashJoiner {
    std::unique_ptr<ScannerType<nation2_t>> nation_scanner;
@@ -96,10 +222,14 @@ struct HashJoiner {
    std::unique_ptr<ScannerType<county_t>> county_scanner;
    std::unique_ptr<ScannerType<city_t>> city_scanner;
    std::unique_ptr<ScannerType<customer2_t>> customer2_scanner;
-   std::optional<HashJoin<sort_key_t, ns_t, nation2_t, states_t>> joiner_ns;
-   std::optional<HashJoin<sort_key_t, nsc_t, ns_t, county_t>> joiner_nsc;
-   std::optional<HashJoin<sort_key_t, nscci_t, nsc_t, city_t>> joiner_nscci;
-   std::optional<HashJoin<sort_key_t, view_t, nscci_t, customer2_t>> final_joiner;
+   using JoinerNS = FusedHashJoin<sort_key_t, ns_t, ScannerType<nation2_t>, ScannerType<states_t>>;
+   using JoinerNSC = FusedHashJoin<sort_key_t, nsc_t, JoinerNS, ScannerType<county_t>>;
+   using JoinerNSCCI = FusedHashJoin<sort_key_t, nscci_t, JoinerNSC, ScannerType<city_t>>;
+   using FinalJoiner = FusedHashJoin<sort_key_t, view_t, JoinerNSCCI, ScannerType<customer2_t>>;
+   std::optional<JoinerNS> joiner_ns;
+   std::optional<JoinerNSC> joiner_nsc;
+   std::optional<JoinerNSCCI> joiner_nscci;
+   std::optional<FinalJoiner> final_joiner;
 
    HashJoiner(AdapterType<nation2_t>& nation,
               AdapterType<states_t>& states,
@@ -116,10 +246,10 @@ struct HashJoiner {
       if (seek_key != sort_key_t::max()) {
          seek(seek_key);
       }
-      joiner_ns.emplace([this]() { return nation_scanner->next(); }, [this]() { return states_scanner->next(); }, seek_key);
-      joiner_nsc.emplace([this]() { return joiner_ns->next(); }, [this]() { return county_scanner->next(); }, seek_key);
-      joiner_nscci.emplace([this]() { return joiner_nsc->next(); }, [this]() { return city_scanner->next(); }, seek_key);
-      final_joiner.emplace([this]() { return joiner_nscci->next(); }, [this]() { return customer2_scanner->next(); }, seek_key);
+      joiner_ns.emplace(*nation_scanner, *states_scanner, seek_key);
+      joiner_nsc.emplace(*joiner_ns, *county_scanner, seek_key);
+      joiner_nscci.emplace(*joiner_nsc, *city_scanner, seek_key);
+      final_joiner.emplace(*joiner_nscci, *customer2_scanner, seek_key);
    }
 
    void run() { final_joiner->run(); }
@@ -138,29 +268,100 @@ struct HashJoiner {
    }
 };
 
+// nation-states-county-city is small and joined serially by the hash joins in the constructor, on the calling
+// worker; the join with customer2 is split into contiguous city ranges, one per job. Each job scans the customers
+// of its range and joins them with its cities in a RadixHashJoin. All jobs read the caller's snapshot (see
+// run_parallel_jobs).
+template <template <typename> class AdapterType, template <typename> class ScannerType>
+struct ParallelHashJoiner {
+   AdapterType<customer2_t>& customer2;
+   std::vector<std::pair<nscci_t::Key, nscci_t>> cities;
+   long produced_cnt = 0;
+
+   ParallelHashJoiner(AdapterType<nation2_t>& nation,
+                      AdapterType<states_t>& states,
+                      AdapterType<county_t>& county,
+                      AdapterType<city_t>& city,
+                      AdapterType<customer2_t>& customer2,
+                      sort_key_t seek_key)
+       : customer2(customer2)
+   {
+      auto nation_scanner = nation.getScanner();
+      auto states_scanner = states.getScanner();
+      auto county_scanner = county.getScanner();
+      auto city_scanner = city.getScanner();
+      nation_scanner->seek(nation2_t::Key{seek_key});
+      states_scanner->seek(states_t::Key{seek_key});
+      county_scanner->seek(county_t::Key{seek_key});
+      city_scanner->seek(city_t::Key{seek_key});
+      using JoinerNS = FusedHashJoin<sort_key_t, ns_t, ScannerType<nation2_t>, ScannerType<states_t>>;
+      using JoinerNSC = FusedHashJoin<sort_key_t, nsc_t, JoinerNS, ScannerType<county_t>>;
+      using JoinerNSCCI = FusedHashJoin<sort_key_t, nscci_t, JoinerNSC, ScannerType<city_t>>;
+      JoinerNS joiner_ns(*nation_scanner, *states_scanner, seek_key);
+      JoinerNSC joiner_nsc(joiner_ns, *county_scanner, seek_key);
+      JoinerNSCCI joiner_nscci(joiner_nsc, *city_scanner, seek_key);
+      while (auto kv = joiner_nscci.next()) {
+         cities.push_back(*kv);
+      }
+      // the hash joins emit in probe order, i.e. in city order
+      std::sort(cities.begin(), cities.end(), [](const auto& a, const auto& b) { return a.first.jk < b.first.jk; });
+   }
+
+   void run()
+   {
+      // the calling worker runs the first job, the workers after it the others
+      const u64 first_worker = first_job_worker();
+      const u64 workers = FLAGS_parallel_join_workers > 0 ? FLAGS_parallel_join_workers : available_job_workers(first_worker) + 1;
+      const u64 jobs = std::clamp<u64>(workers, 1, std::max<size_t>(cities.size(), 1));
+      std::vector<long> produced(jobs, 0);
+      const u64 used = run_parallel_jobs(first_worker, jobs, [&](u64 j) {
+         const size_t begin = cities.size() * j / jobs, end = cities.size() * (j + 1) / jobs;
+         if (begin == end) {
+            return;
+         }
+         RadixHashJoin<sort_key_t, view_t, nscci_t, customer2_t> join;
+         for (size_t i = begin; i < end; i++) {
+            join.add_build(cities[i].first, cities[i].second);
+         }
+         // key-range split scan: customers of the cities [begin, end)
+         const sort_key_t& last_city = cities[end - 1].first.jk;
+         auto scanner = customer2.getScanner();
+         scanner->seek(customer2_t::Key{cities[begin].first.jk});
+         scanner->for_each_view([&](const customer2_t::Key& k, const customer2_t& v) {
+            if (SKBuilder<sort_key_t>::create(k, v).match(last_city) > 0) {
+               return false;
+            }
+            join.add_probe(k, v);
+            return true;
+         });
+         produced[j] = join.run();
+      });
+      static std::once_flag logged;
+      std::call_once(logged, [&]() { std::cout << "Parallel hash join: " << jobs << " jobs on " << used << " worker(s)" << std::endl; });
+      for (long p : produced) {
+         produced_cnt += p;
+      }
+   }
+
+   long produced() const { return produced_cnt; }
+};
+
 template <template <typename> class AdapterType, template <typename...> class MergedAdapterType, template <typename...> class MergedScannerType>
 struct MergedJoiner {
-   std::unique_ptr<MergedScannerType<sort_key_t, view_t, nation2_t, states_t, county_t, city_t, customer2_t>> merged_scanner;
-   std::optional<PremergedJoin<MergedScannerType<sort_key_t, view_t, nation2_t, states_t, county_t, city_t, customer2_t>,
-                               sort_key_t,
-                               view_t,
-                               nation2_t,
-                               states_t,
-                               county_t,
-                               city_t,
-                               customer2_t>>
-       joiner;
+   using MergedScanner = GeoPath::MergedScanner<MergedScannerType, view_t>;
+   std::unique_ptr<MergedScanner> merged_scanner;
+   std::optional<PremergedJoin<MergedScanner, sort_key_t, view_t, nation2_t, states_t, county_t, city_t, customer2_t>> joiner;
    sort_key_t seek_key;
    const sort_key_t seek_max = sort_key_t::max();
 
-   MergedJoiner(MergedAdapterType<nation2_t, states_t, county_t, city_t, customer2_t>& merged, sort_key_t seek_key = sort_key_t::max())
+   MergedJoiner(GeoPath::MergedIndex<MergedAdapterType>& merged, sort_key_t seek_key = sort_key_t::max())
        : merged_scanner(merged.template getScanner<sort_key_t, view_t>()), seek_key(seek_key)
    {
       joiner.emplace(*merged_scanner);
       next();  // first seek
    }
 
-   MergedJoiner(MergedAdapterType<nation2_t, states_t, county_t, city_t, customer2_t>& merged, AdapterType<view_t>& join_view)
+   MergedJoiner(GeoPath::MergedIndex<MergedAdapterType>& merged, AdapterType<view_t>& join_view)
        : merged_scanner(merged.template getScanner<sort_key_t, view_t>()), seek_key(sort_key_t::max())
    {
       joiner.emplace(*merged_scanner, join_view);
@@ -187,6 +388,36 @@ struct MergedJoiner {
 // -------------------------------------------------------------
 // ---------------------- RANGE QUERIES ------------------------
 
+template <template <typename> class AdapterType,
+          template <typename...> class MergedAdapterType,
+          template <typename> class ScannerType,
+          template <typename...> class MergedScannerType>
+template <typename Add>
+void GeoJoin<AdapterType, MergedAdapterType, ScannerType, MergedScannerType>::scan_join_view(sort_key_t& sk, Add&& add)
+{
+   if (FLAGS_deferred_view_maintenance) {
+      bool start = true;
+      join_view_delta.scan_merged(join_view, view_t::Key{sk}, [&](const view_t::Key& vk, const view_t& v) {
+         if (start) {
+            update_sk(sk, vk.jk);
+            start = false;
+         } else if (vk.jk.match(sk) != 0) {
+            return false;
+         }
+         add(v);
+         return true;
+      });
+      return;
+   }
+   join_view.scanFiltered(
+       view_t::Key{sk}, past_selection(sk),
+       [&](const u8*, u16, const u8* payload) {
+          add(*reinterpret_cast<const view_t*>(payload));
+          return false;  // nothing to unfold
+       },
+       [](const view_t::Key&, const view_t&) { return true; });
+}
+
 template <template <typename> class AdapterType,
           template <typename...> class MergedAdapterType,
           template <typename> class ScannerType,
@@ -197,22 +428,8 @@ long GeoJoin<AdapterType, MergedAdapterType, ScannerType, MergedScannerType>::ra
                                                                                                   Integer citykey)
 {
    sort_key_t sk = sort_key_t{nationkey, statekey, countykey, citykey, 0};
-   bool start = true;
    long produced = 0;
-   join_view.scan(
-       view_t::Key{sk},
-       [&](const view_t::Key& vk, const view_t&) {
-          if (start) {
-             update_sk(sk, vk.jk);
-             start = false;
-          }
-          if (vk.jk.match(sk) != 0) {
-             return false;
-          }
-          produced++;
-          return true;
-       },
-       []() {});
+   scan_join_view(sk, [&](const view_t&) { produced++; });
    // std::cout << "range_query_by_view produced " << produced << " records for sk: " << sk << std::endl;
    return produced;
 }
@@ -248,6 +465,11 @@ long GeoJoin<AdapterType, MergedAdapterType, ScannerType, MergedScannerType>::ra
 {
    sort_key_t sk = sort_key_t{nationkey, statekey, countykey, citykey, 0};
 
+   if (FLAGS_multiway_merge_join) {
+      MultiwayBaseJoiner<AdapterType, ScannerType> multiway_joiner(nation, states, county, city, customer2, sk);
+      return multiway_joiner.run();
+   }
+
    BaseJoiner<AdapterType, ScannerType> base_joiner(nation, states, county, city, customer2, sk);
 
    base_joiner.run();
@@ -284,4 +506,30 @@ long GeoJoin<AdapterType, MergedAdapterType, ScannerType, MergedScannerType>::ra
    return produced;
 }
 
-}  // namespace geo_join
\ No newline at end of file
+template <template <typename> class AdapterType,
+          template <typename...> class MergedAdapterType,
+          template <typename> class ScannerType,
+          template <typename...> class MergedScannerType>
+long GeoJoin<AdapterType, MergedAdapterType, ScannerType, MergedScannerType>::range_query_parallel_hash(Integer nationkey,
+                                                                                                        Integer statekey,
+                                                                                                        Integer countykey,
+                                                                                                        Integer citykey)
+{
+   sort_key_t sk = sort_key_t{nationkey, statekey, countykey, citykey, 0};
+
+   city.scan(
+       city_t::Key{sk},
+       [&](const city_t::Key& cik, const city_t& civ) {
+          auto ci_sk = SKBuilder<sort_key_t>::create(cik, civ);
+          update_sk(sk, ci_sk);
+          return false;  // scan once
+       },
+       []() {});
+
+   ParallelHashJoiner<AdapterType, ScannerType> parallel_joiner(nation, states, county, city, customer2, sk);
+
+   parallel_joiner.run();
+   return parallel_joiner.produced();
+}
+
+}  // namespace geo_join
@@ -93,6 +93,17 @@ struct Params {
       return randutils::urand(0, customer_max);
    }
 
+   // First keys of `partitions` nationkey ranges of about as many nations each, for --merged_partitions
+   std::vector<sort_key_t> nation_partition_starts(int partitions) const
+   {
+      const int ranges = std::min(partitions, nation_count);
+      std::vector<sort_key_t> starts;
+      for (int p = 1; p < ranges; p++) {
+         starts.push_back(sort_key_t{1 + p * nation_count / ranges, 0, 0, 0, 0});
+      }
+      return starts;
+   }
+
    int get_nationkey() { return randutils::urand(1, nation_count); }
    int get_statekey() { return randutils::urand(1, state_max / 2); }
    int get_countykey() { return randutils::urand(1, county_max / 2); }
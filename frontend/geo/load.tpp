@@ -1,4 +1,6 @@
 #pragma once
+#include "../shared/merge-join/fused_join.hpp"
+#include "../shared/merge-join/group_by.hpp"
 #include "views.hpp"
 #include "workload.hpp"
 
@@ -48,49 +50,25 @@ void GeoJoin<AdapterType, MergedAdapterType, ScannerType, MergedScannerType>::lo
    auto county_scanner_ptr = county.getScanner();
    auto city_scanner_ptr = city.getScanner();
    auto customer_scanner_ptr = customer2.getScanner();
-   BinaryMergeJoin<sort_key_t, ns_t, nation2_t, states_t> joiner_ns([nation_scanner = nation_scanner_ptr.get()]() { return nation_scanner->next(); },
-                                                                    [states_scanner = states_scanner_ptr.get()]() { return states_scanner->next(); });
-   BinaryMergeJoin<sort_key_t, nsc_t, ns_t, county_t> joiner_nsc([&joiner_ns]() { return joiner_ns.next(); },
-                                                                 [county_scanner = county_scanner_ptr.get()]() { return county_scanner->next(); });
-   BinaryMergeJoin<sort_key_t, nscci_t, nsc_t, city_t> joiner_nscci(
-      [&joiner_nsc]() { return joiner_nsc.next(); },                    
-      [city_scanner = city_scanner_ptr.get()]() { return city_scanner->next(); },                                                             
-      [this](const nscci_t::Key& k, const nscci_t& v) { geo_view.insert(k, v); });
-   BinaryMergeJoin<sort_key_t, view_t, nscci_t, customer2_t> final_joiner(
-      [&joiner_nscci]() { return joiner_nscci.next(); },
-      [customer_scanner = customer_scanner_ptr.get()]() { return customer_scanner->next(); },
-      [this](const view_t::Key& k, const view_t& v) { join_view.insert(k, v); });
+   using JoinerNS = FusedMergeJoin<sort_key_t, ns_t, ScannerType<nation2_t>, ScannerType<states_t>>;
+   using JoinerNSC = FusedMergeJoin<sort_key_t, nsc_t, JoinerNS, ScannerType<county_t>>;
+   using JoinerNSCCI = FusedMergeJoin<sort_key_t, nscci_t, JoinerNSC, ScannerType<city_t>>;
+   using FinalJoiner = FusedMergeJoin<sort_key_t, view_t, JoinerNSCCI, ScannerType<customer2_t>>;
+   JoinerNS joiner_ns(*nation_scanner_ptr, *states_scanner_ptr);
+   JoinerNSC joiner_nsc(joiner_ns, *county_scanner_ptr);
+   JoinerNSCCI joiner_nscci(joiner_nsc, *city_scanner_ptr, [this](const nscci_t::Key& k, const nscci_t& v) { geo_view.insert(k, v); });
+   FinalJoiner final_joiner(joiner_nscci, *customer_scanner_ptr, [this](const view_t::Key& k, const view_t& v) { join_view.insert(k, v); });
    final_joiner.run();
 
    // load cust_count_view
    customer_scanner_ptr->reset();
-   customer_count_t::Key current_cuck{sort_key_t()};
-   Integer current_count = 0;
    long long scanned_customers = 0;
-   while (true) {
-      auto kv = customer_scanner_ptr->next();
-      if (!kv.has_value())
-         break;
-      scanned_customers++;
-      auto [k, v] = *kv;
-      sort_key_t sk = SKBuilder<sort_key_t>::create(k, v);
-      customer_count_t::Key cuck{sk};
-      if (current_cuck != cuck) {
-         // new key
-         if (current_count > 0) {
-            customer_count_t cuc_v{current_count};
-            cust_count_view.insert(current_cuck, cuc_v);
-         }
-         current_count = 0;
-      }
-      current_count++;
-      current_cuck = cuck;
-   }
-   // insert the last key
-   if (current_count > 0) {
-      customer_count_t cuc_v{current_count};
-      cust_count_view.insert(current_cuck, cuc_v);
-   }
+   auto customers_per_city =
+       group_by<customer_count_t::Key>([](const customer2_t::Key& k, const customer2_t&) { return customer_count_t::Key{k}; }, agg::Count{});
+   customers_per_city.run(*customer_scanner_ptr, [&](const customer_count_t::Key& cuck, const agg::Count& count) {
+      cust_count_view.insert(cuck, customer_count_t{static_cast<Integer>(count.value)});
+      scanned_customers += count.value;
+   });
    std::cout << "Scanned " << scanned_customers << " customers to build customer_count_view." << std::endl;
 
    log_sizes();
@@ -62,26 +62,29 @@ void GeoJoin<AdapterType, MergedAdapterType, ScannerType, MergedScannerType>::se
    std::cout << "Doing a full scan of merged to randomly select " << maintenance_state.city_count << " for insertion...";
    auto scanner = merged.template getScanner<sort_key_t, view_t>();
    long long scanned = 0;
-   while (true) {
-      scanned++;
-      auto kv = scanner->next();
-      if (!kv.has_value()) {
-         break;  // no more cities
-      }
-      auto [k, v] = *kv;
-      sort_key_t sk = SKBuilder<sort_key_t>::create(k, v);
-      if (sk.citykey == 0) {
-         continue;  // skip nation, states, county records
-      } else if (sk.custkey != 0) {
-         // do search to avoid scanning many customers in one city
-         scanner->seekJK(sort_key_t{sk.nationkey, sk.statekey, sk.countykey, sk.citykey, std::numeric_limits<Integer>::max()});
-         continue;
-      }
-      maintenance_state.select(sk);
-      if (scanned % 1000 == 0 && FLAGS_log_progress) {
-         std::cout << "\rScanned " << scanned << " cities...";
+   std::optional<sort_key_t> skip_to = std::nullopt;
+   do {
+      if (skip_to.has_value()) {
+         scanner->seekJK(*skip_to);
+         skip_to = std::nullopt;
       }
-   }
+      scanner->for_each_view([&](const auto& k, const auto& v) {
+         scanned++;
+         sort_key_t sk = SKBuilder<sort_key_t>::create(k, v);
+         if (sk.citykey == 0) {
+            return true;  // skip nation, states, county records
+         } else if (sk.custkey != 0) {
+            // do search to avoid scanning many customers in one city
+            skip_to = sort_key_t{sk.nationkey, sk.statekey, sk.countykey, sk.citykey, std::numeric_limits<Integer>::max()};
+            return false;
+         }
+         maintenance_state.select(sk);
+         if (scanned % 1000 == 0 && FLAGS_log_progress) {
+            std::cout << "\rScanned " << scanned << " cities...";
+         }
+         return true;
+      });
+   } while (skip_to.has_value());
    std::cout << std::endl;
 }
 template <template <typename> class AdapterType,
@@ -95,19 +98,14 @@ void GeoJoin<AdapterType, MergedAdapterType, ScannerType, MergedScannerType>::se
    std::cout << "Doing a full scan of cities to randomly select " << maintenance_state.city_count << " for insertion...";
    auto scanner = city.getScanner();
    long long scanned = 0;
-   while (true) {
+   scanner->for_each_view([&](const city_t::Key& k, const city_t& v) {
       scanned++;
-      auto kv = scanner->next();
-      if (!kv.has_value()) {
-         break;  // no more cities
-      }
-      auto [k, v] = *kv;
-      sort_key_t sk = SKBuilder<sort_key_t>::create(k, v);
-      maintenance_state.select(sk);
+      maintenance_state.select(SKBuilder<sort_key_t>::create(k, v));
       if (scanned % 1000 == 0 && FLAGS_log_progress) {
          std::cout << "\rScanned " << scanned << " cities...";
       }
-   }
+      return true;
+   });
    std::cout << std::endl;
 }
 
@@ -124,6 +122,7 @@ bool GeoJoin<AdapterType, MergedAdapterType, ScannerType, MergedScannerType>::er
    bool ret = customer2.erase(customer2_t::Key{sk});
    if (!ret)
       std::cerr << "Error erasing customer with key: " << sk << std::endl;
+   invalidate_cached(sk);
    maintenance_state.adjust_ptrs();
    return true;
 }
@@ -140,6 +139,7 @@ bool GeoJoin<AdapterType, MergedAdapterType, ScannerType, MergedScannerType>::er
    bool ret = merged.template erase<customer2_t>(customer2_t::Key{sk});
    if (!ret)
       std::cerr << "Error erasing customer with key: " << sk << std::endl;
+   invalidate_cached(sk);
    maintenance_state.adjust_ptrs();
    return true;
 }
@@ -152,7 +152,39 @@ bool GeoJoin<AdapterType, MergedAdapterType, ScannerType, MergedScannerType>::er
 {
    if (!maintenance_state.customer_to_erase())
       return false;
-   sort_key_t sk = maintenance_state.next_cust_to_erase();
+   erase_view(maintenance_state.next_cust_to_erase());
+   maintenance_state.adjust_ptrs();
+   return true;
+}
+
+template <template <typename> class AdapterType,
+          template <typename...> class MergedAdapterType,
+          template <typename> class ScannerType,
+          template <typename...> class MergedScannerType>
+void GeoJoin<AdapterType, MergedAdapterType, ScannerType, MergedScannerType>::erase_view(const sort_key_t& sk)
+{
+   if (FLAGS_deferred_view_maintenance) {
+      if (!customer2.erase(customer2_t::Key{sk})) {
+         std::stringstream ss;
+         ss << "Error erasing customer in view, sk: " << sk;
+         throw std::runtime_error(ss.str());
+      }
+      // recorded after the B-tree writes, which are the ones that can abort
+      join_view_delta.erase(view_t::Key{sk});
+      cust_count_delta.add(customer_count_t::Key{sk}, -1);
+      invalidate_cached(sk);
+      if (view_deltas_due()) {
+         fold_view_deltas();
+      }
+      return;
+   }
+   if (FLAGS_maintenance_batch > 0) {
+      customer_deltas.erase(customer2_t::Key{sk});
+      if (customer_deltas.size() >= static_cast<size_t>(FLAGS_maintenance_batch)) {
+         flush_view_deltas();
+      }
+      return;
+   }
    view_t::Key vk{sk};
    bool ret_jv = join_view.erase(vk);
    bool ret_c = customer2.erase(customer2_t::Key{sk});
@@ -164,8 +196,7 @@ bool GeoJoin<AdapterType, MergedAdapterType, ScannerType, MergedScannerType>::er
    // mixed_view_t::Key mixed_vk{sk};
    // mixed_view.update1(mixed_vk, [](mixed_view_t& v) { std::get<4>(v.payloads).customer_count--; });
    cust_count_view.update1(customer_count_t::Key{sk}, [](customer_count_t& v) { v.customer_count--; });
-   maintenance_state.adjust_ptrs();
-   return true;
+   invalidate_cached(sk);
 }
 
 template <template <typename> class AdapterType,
@@ -185,6 +216,7 @@ void GeoJoin<AdapterType, MergedAdapterType, ScannerType, MergedScannerType>::ma
       // state_name, county_name, city_name);
    customer2_t::Key cust_key{sk};
    customer2.insert(cust_key, cust_val);
+   invalidate_cached(sk);
    if (maintenance_state.erased_idx == 0)
       maintenance_state.delta_table << cust_key << cust_val << "\n";
 }
@@ -206,6 +238,7 @@ void GeoJoin<AdapterType, MergedAdapterType, ScannerType, MergedScannerType>::ma
    customer2_t cust_val = customer2_t::generateRandomRecord();
       // state_name, county_name, city_name);
    merged.insert(cust_key, cust_val);
+   invalidate_cached(sk);
 }
 
 template <template <typename> class AdapterType,
@@ -214,7 +247,22 @@ template <template <typename> class AdapterType,
           template <typename...> class MergedScannerType>
 void GeoJoin<AdapterType, MergedAdapterType, ScannerType, MergedScannerType>::maintain_view()
 {
-   sort_key_t sk = maintenance_state.next_cust_to_insert();
+   maintain_view(maintenance_state.next_cust_to_insert(), customer2_t::generateRandomRecord());
+}
+
+template <template <typename> class AdapterType,
+          template <typename...> class MergedAdapterType,
+          template <typename> class ScannerType,
+          template <typename...> class MergedScannerType>
+void GeoJoin<AdapterType, MergedAdapterType, ScannerType, MergedScannerType>::maintain_view(const sort_key_t& sk, const customer2_t& cuv)
+{
+   if (FLAGS_maintenance_batch > 0 && !FLAGS_deferred_view_maintenance) {
+      customer_deltas.insert(customer2_t::Key{sk}, cuv);
+      if (customer_deltas.size() >= static_cast<size_t>(FLAGS_maintenance_batch)) {
+         flush_view_deltas();
+      }
+      return;
+   }
    nation2_t nv;
    states_t sv;
    county_t cv;
@@ -225,15 +273,22 @@ void GeoJoin<AdapterType, MergedAdapterType, ScannerType, MergedScannerType>::ma
    city.lookup1(city_t::Key{sk}, [&](const city_t& ci) { civ = ci; });
 
    customer2_t::Key cuk{sk};
-   customer2_t cuv = customer2_t::generateRandomRecord();
-      // sv.name, cv.name, civ.name);
    customer2.insert(cuk, cuv);
-   
+
    view_t::Key vk{sk};
    view_t v{nv, sv, cv, civ, cuv};
+   customer_count_t::Key cuck{sk};
+   if (FLAGS_deferred_view_maintenance) {
+      join_view_delta.insert(vk, v);
+      cust_count_delta.add(cuck, 1);
+      invalidate_cached(sk);
+      if (view_deltas_due()) {
+         fold_view_deltas();
+      }
+      return;
+   }
    join_view.insert(vk, v);
 
-   customer_count_t::Key cuck{sk};
    bool customer_exists = cust_count_view.tryLookup(cuck, [&](const customer_count_t&) {});
    if (customer_exists) {
       // mixed_view.update1(mixed_vk, [&](mixed_view_t& mv) { std::get<4>(mv.payloads).customer_count++; });
@@ -241,5 +296,117 @@ void GeoJoin<AdapterType, MergedAdapterType, ScannerType, MergedScannerType>::ma
    } else {
       cust_count_view.insert(cuck, customer_count_t{1});
    }
+   invalidate_cached(sk);
+}
+
+template <template <typename> class AdapterType,
+          template <typename...> class MergedAdapterType,
+          template <typename> class ScannerType,
+          template <typename...> class MergedScannerType>
+void GeoJoin<AdapterType, MergedAdapterType, ScannerType, MergedScannerType>::maintain_all()
+{
+   sort_key_t sk = maintenance_state.next_cust_to_insert();
+   customer2_t cuv = customer2_t::generateRandomRecord();
+   maintain_view(sk, cuv);  // also customer2, which the base and hash joins read
+   merged.insert(customer2_t::Key{sk}, cuv);
+   invalidate_cached(sk);
+}
+
+template <template <typename> class AdapterType,
+          template <typename...> class MergedAdapterType,
+          template <typename> class ScannerType,
+          template <typename...> class MergedScannerType>
+bool GeoJoin<AdapterType, MergedAdapterType, ScannerType, MergedScannerType>::erase_all()
+{
+   if (!maintenance_state.customer_to_erase())
+      return false;
+   sort_key_t sk = maintenance_state.next_cust_to_erase();
+   erase_view(sk);
+   if (!merged.template erase<customer2_t>(customer2_t::Key{sk}))
+      std::cerr << "Error erasing customer with key: " << sk << std::endl;
+   invalidate_cached(sk);
+   maintenance_state.adjust_ptrs();
+   return true;
+}
+
+template <template <typename> class AdapterType,
+          template <typename...> class MergedAdapterType,
+          template <typename> class ScannerType,
+          template <typename...> class MergedScannerType>
+void GeoJoin<AdapterType, MergedAdapterType, ScannerType, MergedScannerType>::flush_view_deltas()
+{
+   if (customer_deltas.empty()) {
+      return;
+   }
+   const auto& changes = customer_deltas.sorted();
+   // one ordered pass per tree; the buffer is only cleared once all of them went through, so that an aborted
+   // transaction retries the epoch
+   for (const auto& c : changes) {
+      if (c.erase) {
+         if (!customer2.erase(c.key)) {
+            std::stringstream ss;
+            ss << "Error erasing customer in view, sk: " << c.key;
+            throw std::runtime_error(ss.str());
+         }
+      } else {
+         customer2.insert(c.key, c.record);
+      }
+   }
+
+   // the customers of a city are consecutive, so its ancestors are looked up once
+   sort_key_t cached_city = sort_key_t::max();
+   nation2_t nv;
+   states_t sv;
+   county_t cv;
+   city_t civ;
+   CounterDeltas<customer_count_t> count_deltas;
+   for (const auto& c : changes) {
+      const sort_key_t sk = SKBuilder<sort_key_t>::create(c.key, c.record);
+      if (c.erase) {
+         if (!join_view.erase(view_t::Key{sk})) {
+            std::stringstream ss;
+            ss << "Error erasing customer in join_view, sk: " << sk;
+            throw std::runtime_error(ss.str());
+         }
+         count_deltas.add(customer_count_t::Key{sk}, -1);
+         continue;
+      }
+      const sort_key_t city_sk = SKBuilder<sort_key_t>::get<city_t>(sk);
+      if (city_sk != cached_city) {
+         nation.lookup1(nation2_t::Key{sk}, [&](const nation2_t& n) { nv = n; });
+         states.lookup1(states_t::Key{sk}, [&](const states_t& s) { sv = s; });
+         county.lookup1(county_t::Key{sk}, [&](const county_t& cty) { cv = cty; });
+         city.lookup1(city_t::Key{sk}, [&](const city_t& ci) { civ = ci; });
+         cached_city = city_sk;
+      }
+      join_view.insert(view_t::Key{sk}, view_t{nv, sv, cv, civ, c.record});
+      count_deltas.add(customer_count_t::Key{sk}, 1);
+   }
+
+   for (const auto& c : changes) {
+      invalidate_cached(SKBuilder<sort_key_t>::create(c.key, c.record));
+   }
+   count_deltas.for_each_sorted([&](const customer_count_t::Key& cuck, long delta) {
+      bool customer_exists = cust_count_view.tryLookup(cuck, [&](const customer_count_t&) {});
+      if (customer_exists) {
+         cust_count_view.update1(cuck, [&](customer_count_t& v) { v.customer_count += delta; });
+      } else {
+         cust_count_view.insert(cuck, customer_count_t{static_cast<Integer>(delta)});
+      }
+   });
+   customer_deltas.clear();
+}
+
+template <template <typename> class AdapterType,
+          template <typename...> class MergedAdapterType,
+          template <typename> class ScannerType,
+          template <typename...> class MergedScannerType>
+void GeoJoin<AdapterType, MergedAdapterType, ScannerType, MergedScannerType>::fold_view_deltas()
+{
+   // the deltas stay pending until this transaction committed, an abort leaves them to the next fold
+   join_view_delta.fold(join_view);
+   cust_count_delta.fold(
+       cust_count_view, [](customer_count_t& v, long delta) { v.customer_count += delta; },
+       [](long delta) { return customer_count_t{static_cast<Integer>(delta)}; });
 }
-}  // namespace geo_join
\ No newline at end of file
+}  // namespace geo_join
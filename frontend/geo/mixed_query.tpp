@@ -1,9 +1,13 @@
 #pragma once
 
 #include <optional>
+#include "../shared/distinct_count.hpp"
+#include "../shared/merge-join/group_by.hpp"
 #include "views.hpp"
 #include "workload.hpp"
 
+DECLARE_bool(approx_distinct);
+
 // SELECT nationkey, statekey, countykey, citykey, city_name, COUNT(*) as customer_count
 // FROM city, customer
 // WHERE ... -- all keys equal && outer join
@@ -11,6 +15,18 @@
 
 namespace geo_join
 {
+// c_mktsegment of a customer, for COUNT(DISTINCT c_mktsegment)
+struct mktsegment_of {
+   const Varchar<10>& operator()(const auto&, const customer2_t& v) const { return v.c_mktsegment; }
+   const Varchar<10>& operator()(const auto&, const view_t& v) const { return std::get<4>(v.payloads).c_mktsegment; }
+};
+using MktsegmentCount = agg::ShortStringDistinctCount<mktsegment_of>;
+
+inline MktsegmentCount mktsegment_count()
+{
+   return MktsegmentCount(mktsegment_of{}, FLAGS_approx_distinct);
+}
+
 template <template <typename> class AdapterType,
           template <typename...> class MergedAdapterType,
           template <typename> class ScannerType,
@@ -51,24 +67,14 @@ long GeoJoin<AdapterType, MergedAdapterType, ScannerType, MergedScannerType>::ra
             break;
          }
       }
+      if (FLAGS_deferred_view_maintenance) {
+         cust_sum += cust_count_delta.sum(customer_count_t::Key(select_sk),
+                                          [&](const customer_count_t::Key& k) { return k.get_jk().match(select_sk) == 0; });
+      }
    } else {
-      std::vector<Varchar<10>> seen_mktsegments;
-      join_view.scan(
-          view_t::Key{select_sk},
-          [&](const view_t::Key& vk, const view_t& v) {
-             auto curr_sk = SKBuilder<sort_key_t>::create(vk, v);
-             if (cust_sum == 0) {
-                update_sk(select_sk, curr_sk);
-             } else if (curr_sk.match(select_sk) != 0) {
-                return false;
-             }
-             if (std::find(seen_mktsegments.begin(), seen_mktsegments.end(), std::get<4>(v.payloads).c_mktsegment) == seen_mktsegments.end()) {
-                seen_mktsegments.push_back(std::get<4>(v.payloads).c_mktsegment);
-                cust_sum++;
-             }
-             return true;
-          },
-          []() {});
+      MktsegmentCount mktsegments = mktsegment_count();
+      scan_join_view(select_sk, [&](const view_t& v) { mktsegments.add(select_sk, v); });  // mktsegment_of reads v only
+      cust_sum = mktsegments.value;
    }
 
    return cust_sum;
@@ -76,13 +82,13 @@ long GeoJoin<AdapterType, MergedAdapterType, ScannerType, MergedScannerType>::ra
 
 template <template <typename...> class MergedAdapterType, template <typename...> class MergedScannerType>
 struct MergedScannerCounter {
-   std::unique_ptr<MergedScannerType<sort_key_t, view_t, nation2_t, states_t, county_t, city_t, customer2_t>> scanner;
+   std::unique_ptr<GeoPath::MergedScanner<MergedScannerType, view_t>> scanner;
    long long produced = 0;
    const bool distinct;
    using K = std::variant<nation2_t::Key, states_t::Key, county_t::Key, city_t::Key, customer_count_t::Key>;
    using V = std::variant<nation2_t, states_t, county_t, city_t, customer_count_t>;
 
-   MergedScannerCounter(MergedAdapterType<nation2_t, states_t, county_t, city_t, customer2_t>& merged,
+   MergedScannerCounter(GeoPath::MergedIndex<MergedAdapterType>& merged,
                         bool distinct,
                         sort_key_t sk = sort_key_t::max())
        : scanner(merged.template getScanner<sort_key_t, view_t>()), distinct(distinct)
@@ -95,7 +101,7 @@ struct MergedScannerCounter {
    // all methods required by premerged join
 
    std::optional<std::pair<K, V>> buffered_output = std::nullopt;
-   std::vector<Varchar<10>> seen_mktsegments;
+   MktsegmentCount mktsegments = mktsegment_count();
 
    std::optional<std::pair<K, V>> next(sort_key_t last_sk = sort_key_t::max(), int customer_count = 0)
    {
@@ -105,7 +111,7 @@ struct MergedScannerCounter {
          return ret;
       }
       if (customer_count == 0) {
-         seen_mktsegments.clear();
+         mktsegments.reset();
       }
       auto kv = scanner->next();
       // get type from variant
@@ -128,10 +134,8 @@ struct MergedScannerCounter {
                                if (!distinct) {
                                   customer_count++;
                                } else {
-                                  if (std::find(seen_mktsegments.begin(), seen_mktsegments.end(), cu.c_mktsegment) == seen_mktsegments.end()) {
-                                     seen_mktsegments.push_back(cu.c_mktsegment);
-                                     customer_count++;
-                                  }
+                                  mktsegments.add(curr_sk, cu);
+                                  customer_count = mktsegments.value;
                                }
                             }},
                  v);
@@ -199,13 +203,13 @@ struct MergedCounter {
 
    sort_key_t seek_key;
    const sort_key_t seek_max = sort_key_t::max();
-   MergedCounter(MergedAdapterType<nation2_t, states_t, county_t, city_t, customer2_t>& merged, bool distinct, sort_key_t sk = sort_key_t::max())
+   MergedCounter(GeoPath::MergedIndex<MergedAdapterType>& merged, bool distinct, sort_key_t sk = sort_key_t::max())
        : scanner_counter(merged, distinct), joiner(scanner_counter), seek_key(sk)
    {
       next();  // first seek
    }
 
-   MergedCounter(MergedAdapterType<nation2_t, states_t, county_t, city_t, customer2_t>& merged,
+   MergedCounter(GeoPath::MergedIndex<MergedAdapterType>& merged,
                  AdapterType<mixed_view_t>& mixed_view,
                  bool distinct,
                  sort_key_t sk = sort_key_t::max())
@@ -259,34 +263,24 @@ long GeoJoin<AdapterType, MergedAdapterType, ScannerType, MergedScannerType>::ra
    return cust_sum;
 }
 
+// COUNT(*), or COUNT(DISTINCT c_mktsegment) with distinct, of the customers of each city, one city per call
 template <template <typename> class ScannerType>
-std::optional<std::pair<customer_count_t::Key, customer_count_t>> next_cust_count(std::unique_ptr<ScannerType<customer2_t>>& customer, bool distinct)
+std::function<std::optional<std::pair<customer_count_t::Key, customer_count_t>>()> customer_counts(ScannerType<customer2_t>& customer, bool distinct)
 {
-   int customer_count = 0;
-   std::vector<Varchar<10>> seen_mktsegments;
-   std::optional<customer_count_t::Key> curr_key = std::nullopt;
-   while (true) {
-      auto kv = customer->next();
-      if (!kv.has_value()) {
-         return std::nullopt;
-      }
-      auto [k, v] = *kv;
-      if (curr_key == std::nullopt) {
-         curr_key = customer_count_t::Key{k};
-      } else if (curr_key->nationkey != k.nationkey || curr_key->statekey != k.statekey || curr_key->countykey != k.countykey ||
-                 curr_key->citykey != k.citykey) {
-         customer->after_seek = true;  // rescan this customer
-         return std::make_pair(*curr_key, customer_count_t{customer_count});
-      }
-      if (!distinct) {
-         customer_count++;
-      } else {
-         if (std::find(seen_mktsegments.begin(), seen_mktsegments.end(), v.c_mktsegment) == seen_mktsegments.end()) {
-            seen_mktsegments.push_back(v.c_mktsegment);
-            customer_count++;
+   auto city_of = [](const customer2_t::Key& k, const customer2_t&) { return customer_count_t::Key{k}; };
+   auto pull = [scanner = &customer](auto groups) {
+      return [scanner, groups]() mutable -> std::optional<std::pair<customer_count_t::Key, customer_count_t>> {
+         auto group = groups.next(*scanner);
+         if (!group.has_value()) {
+            return std::nullopt;
          }
-      }
+         return std::make_pair(group->first, customer_count_t{static_cast<Integer>(std::get<0>(group->second).value)});
+      };
+   };
+   if (distinct) {
+      return pull(group_by<customer_count_t::Key>(city_of, mktsegment_count()));
    }
+   return pull(group_by<customer_count_t::Key>(city_of, agg::Count{}));
 }
 
 template <template <typename> class AdapterType, template <typename> class ScannerType>
@@ -314,10 +308,11 @@ struct BaseCounter {
       if (sk != sort_key_t::max()) {
          seek(sk);
       }
-      joiner_ns.emplace([this]() { return nation->next(); }, [this]() { return states->next(); });
-      joiner_nsc.emplace([this]() { return joiner_ns->next(); }, [this]() { return county->next(); });
-      joiner_nscci.emplace([this]() { return joiner_nsc->next(); }, [this]() { return city->next(); });
-      final_joiner.emplace([this]() { return joiner_nscci->next(); }, [this, distinct]() { return next_cust_count(customer, distinct); });
+      joiner_ns.emplace([this](auto& batch) { return nation->next_batch(batch); }, [this](auto& batch) { return states->next_batch(batch); });
+      joiner_nsc.emplace([this](auto& batch) { return joiner_ns->next_batch(batch); }, [this](auto& batch) { return county->next_batch(batch); });
+      joiner_nscci.emplace([this](auto& batch) { return joiner_nsc->next_batch(batch); }, [this](auto& batch) { return city->next_batch(batch); });
+      final_joiner.emplace([this](auto& batch) { return joiner_nscci->next_batch(batch); },
+                           customer_counts<ScannerType>(*customer, distinct));
       auto first_ret = final_joiner->next();
       if (first_ret.has_value()) {
          update_sk(sk, first_ret->first.jk);
@@ -387,10 +382,14 @@ struct HashCounter {
       if (sk != sort_key_t::max()) {
          seek(sk);
       }
-      joiner_ns.emplace([this]() { return nation->next(); }, [this]() { return states->next(); }, sk);
-      joiner_nsc.emplace([this]() { return joiner_ns->next(); }, [this]() { return county->next(); }, sk);
-      joiner_nscci.emplace([this]() { return joiner_nsc->next(); }, [this]() { return city->next(); }, sk);
-      final_joiner.emplace([this]() { return joiner_nscci->next(); }, [this, distinct]() { return next_cust_count(customer, distinct); }, sk);
+      joiner_ns.emplace([this](auto& batch) { return nation->next_batch(batch); }, [this](auto& batch) { return states->next_batch(batch); }, sk);
+      joiner_nsc.emplace([this](auto& batch) { return joiner_ns->next_batch(batch); }, [this](auto& batch) { return county->next_batch(batch); }, sk);
+      joiner_nscci.emplace([this](auto& batch) { return joiner_nsc->next_batch(batch); },
+                           [this](auto& batch) { return city->next_batch(batch); },
+                           sk);
+      final_joiner.emplace([this](auto& batch) { return joiner_nscci->next_batch(batch); },
+                           customer_counts<ScannerType>(*customer, distinct),
+                           sk);
    }
 
    void run() { final_joiner->run(); }
@@ -1,5 +1,12 @@
 #pragma once
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
 #include <string>
+#include "../shared/query_router.hpp"
 #include "workload.hpp"
 
 namespace geo_join
@@ -13,53 +20,55 @@ struct PerStructureWorkload {
    std::string get_name() const { return name; }
    void join_n()
    {
-      long produced = workload.join(workload.next_nation_to_scan(), 0, 0, 0);
+      long produced = cached_join(workload.next_nation_to_scan(), 0, 0, 0);
       workload.new_n_join(produced);
    }
    void join_ns()
    {
-      long produced = workload.join(workload.get_nationkey(), workload.get_statekey(), 0, 0);
+      long produced = cached_join(workload.get_nationkey(), workload.get_statekey(), 0, 0);
       workload.new_ns_join(produced);
    }
    void join_nsc()
    {
-      long produced = workload.join(workload.get_nationkey(), workload.get_statekey(), workload.get_countykey(), 0);
+      long produced = cached_join(workload.get_nationkey(), workload.get_statekey(), workload.get_countykey(), 0);
       workload.new_nsc_join(produced);
    }
    void mixed_n()
    {
-      long cust_sum = workload.mixed(workload.next_nation_to_scan(), 0, 0, 0);
+      long cust_sum = cached_mixed(workload.next_nation_to_scan(), 0, 0, 0);
       workload.new_n_mixed(cust_sum);
    }
    void mixed_ns()
    {
-      long cust_sum = workload.mixed(workload.get_nationkey(), workload.get_statekey(), 0, 0);
+      long cust_sum = cached_mixed(workload.get_nationkey(), workload.get_statekey(), 0, 0);
       workload.new_ns_mixed(cust_sum);
    }
    void mixed_nsc()
    {
-      long cust_sum = workload.mixed(workload.get_nationkey(), workload.get_statekey(), workload.get_countykey(), 0);
+      long cust_sum = cached_mixed(workload.get_nationkey(), workload.get_statekey(), workload.get_countykey(), 0);
       workload.new_nsc_mixed(cust_sum);
    }
 
    void distinct_n()
    {
-      long distinct = workload.distinct(workload.next_nation_to_scan(), 0, 0, 0);
+      long distinct = cached_distinct(workload.next_nation_to_scan(), 0, 0, 0);
       workload.new_n_distinct(distinct);
    }
    void distinct_ns()
    {
-      long distinct = workload.distinct(workload.get_nationkey(), workload.get_statekey(), 0, 0);
+      long distinct = cached_distinct(workload.get_nationkey(), workload.get_statekey(), 0, 0);
       workload.new_ns_distinct(distinct);
    }
    void distinct_nsc()
    {
-      long distinct = workload.distinct(workload.get_nationkey(), workload.get_statekey(), workload.get_countykey(), 0);
+      long distinct = cached_distinct(workload.get_nationkey(), workload.get_statekey(), workload.get_countykey(), 0);
       workload.new_nsc_distinct(distinct);
    }
    void insert1() { workload.insert1(); }
    bool erase1() { return workload.erase1(); }
    void cleanup_updates() { workload.cleanup_updates(); }
+   bool view_deltas_due() { return workload.view_deltas_due(); }
+   void fold_view_deltas() { workload.fold_view_deltas(); }
    double get_size() { return workload.get_size(); }
    bool insertion_complete() { return workload.insertion_complete(); }
    void bg_lookup() { workload.bg_lookup(); }
@@ -67,6 +76,22 @@ struct PerStructureWorkload {
    void reset_maintain_ptrs() { workload.reset_maintain_ptrs(); }
    void select_to_insert() { workload.select_to_insert(); }
    bool n_scan_finished() const { return workload.n_scan_finished(); }
+   std::vector<std::pair<std::string, long>> take_counters() { return workload.take_counters(); }
+
+  private:
+   // Queries through the result cache (--result_cache_entries)
+   long cached_join(Integer n, Integer s, Integer c, Integer ci)
+   {
+      return workload.cached_result(JOIN, sort_key_t{n, s, c, ci, 0}, [&]() { return workload.join(n, s, c, ci); });
+   }
+   long cached_mixed(Integer n, Integer s, Integer c, Integer ci)
+   {
+      return workload.cached_result(MIXED, sort_key_t{n, s, c, ci, 0}, [&]() { return workload.mixed(n, s, c, ci); });
+   }
+   long cached_distinct(Integer n, Integer s, Integer c, Integer ci)
+   {
+      return workload.cached_result(DISTINCT, sort_key_t{n, s, c, ci, 0}, [&]() { return workload.distinct(n, s, c, ci); });
+   }
 };
 
 template <template <typename> class AdapterType,
@@ -85,6 +110,21 @@ struct GeoJoinWrapper {
    Integer get_countykey() { return workload.params.get_countykey(); }
    Integer get_citykey() { return workload.params.get_citykey(); }
    Integer next_nation_to_scan() { return workload.get_n().first; }
+   const Params& get_params() const { return workload.params; }
+
+   template <typename Run>
+   long cached_result(QueryKind kind, const sort_key_t& sk, Run&& run)
+   {
+      return workload.cached_result(kind, sk, std::forward<Run>(run));
+   }
+   std::vector<std::pair<std::string, long>> take_counters()
+   {
+      if (!workload.result_cache.enabled()) {
+         return {};
+      }
+      const auto [hits, misses] = workload.result_cache.take_counters();
+      return {{"Cache Hits", hits}, {"Cache Misses", misses}};
+   }
 
    void new_n_join(long produced) { workload.stats.new_n_join(produced); };
    void new_ns_join(long produced) { workload.stats.new_ns_join(produced); };
@@ -104,6 +144,8 @@ struct GeoJoinWrapper {
    void reset_maintain_ptrs() { workload.maintenance_state.reset(); }
    void select_to_insert() { workload.select_to_insert(); }
    bool n_scan_finished() const { return workload.get_n(true).second; }
+   bool view_deltas_due() { return false; }  // only views defer maintenance
+   void fold_view_deltas() {}
 };
 
 template <template <typename> class AdapterType,
@@ -167,6 +209,8 @@ struct ViewGeoJoin : public GeoJoinWrapper<AdapterType, MergedAdapterType, Scann
 
    bool erase1() { return workload.erase_view(); }
    void cleanup_updates() { workload.cleanup_view(); }
+   bool view_deltas_due() { return workload.view_deltas_due(); }
+   void fold_view_deltas() { workload.fold_view_deltas(); }
    double get_size() { return workload.get_view_size(); }
 
    void select_to_insert() { workload.select_to_insert(); }
@@ -230,4 +274,171 @@ struct HashGeoJoin : public GeoJoinWrapper<AdapterType, MergedAdapterType, Scann
    void select_to_insert() { workload.select_to_insert(); }
 };
 
+// Same maintenance and mixed queries as HashGeoJoin, joins with the parallel radix hash join
+template <template <typename> class AdapterType,
+          template <typename...> class MergedAdapterType,
+          template <typename> class ScannerType,
+          template <typename...> class MergedScannerType>
+struct ParallelHashGeoJoin : public HashGeoJoin<AdapterType, MergedAdapterType, ScannerType, MergedScannerType> {
+   using GeoJoinWrapper<AdapterType, MergedAdapterType, ScannerType, MergedScannerType>::workload;
+
+   ParallelHashGeoJoin(GeoJoin<AdapterType, MergedAdapterType, ScannerType, MergedScannerType>& workload) : HashGeoJoin<AdapterType, MergedAdapterType, ScannerType, MergedScannerType>(workload) {}
+
+   long join(Integer nationkey, Integer statekey, Integer countykey, Integer citykey)
+   {
+      return workload.range_query_parallel_hash(nationkey, statekey, countykey, citykey);
+   }
+};
+
+// Keeps all structures maintained and sends every query to the access path expected to be the cheapest for its kind
+// and selection depth (see AccessPathRouter). The priors assume that a query reads its share of the structure, as
+// given by the average fanouts of Params, with the structures competing for --dram_gib. Each query is logged with
+// its plan to plans.csv under --csv_path. With --maintenance_batch, customer2 lags behind by the buffered epoch, so
+// the paths that read it are only routed to once the background worker flushed it (see view_deltas_due).
+template <template <typename> class AdapterType,
+          template <typename...> class MergedAdapterType,
+          template <typename> class ScannerType,
+          template <typename...> class MergedScannerType>
+struct RoutedGeoJoin : public GeoJoinWrapper<AdapterType, MergedAdapterType, ScannerType, MergedScannerType> {
+   using GeoJoinWrapper<AdapterType, MergedAdapterType, ScannerType, MergedScannerType>::workload;
+
+   enum Path : size_t { BASE, VIEW, MERGED, HASH, PATHS };
+   static constexpr size_t DEPTHS = 4;  // nationkey up to citykey selected
+   static constexpr std::array<const char*, PATHS> path_names{"base_idx", "mat_view", "merged_idx", "hash"};
+   static constexpr std::array<const char*, QUERY_KINDS> kind_names{"join", "mixed", "distinct"};
+
+   AccessPathRouter<PATHS, QUERY_KINDS * DEPTHS> router;
+   std::ofstream plans;
+   std::atomic<bool> customer2_flush_requested = false;
+
+   RoutedGeoJoin(GeoJoin<AdapterType, MergedAdapterType, ScannerType, MergedScannerType>& workload)
+       : GeoJoinWrapper<AdapterType, MergedAdapterType, ScannerType, MergedScannerType>(workload)
+   {
+      set_priors();
+      std::filesystem::path dir(FLAGS_csv_path);
+      std::filesystem::create_directories(dir);
+      const bool exists = std::filesystem::exists(dir / "plans.csv");
+      plans.open(dir / "plans.csv", std::ios::out | std::ios::app);
+      if (!exists) {
+         plans << "kind,nationkey,statekey,countykey,citykey,plan,expected_ns,measured,elapsed_ns,result" << std::endl;
+      }
+   }
+
+   long join(Integer nationkey, Integer statekey, Integer countykey, Integer citykey)
+   {
+      return route(JOIN, sort_key_t{nationkey, statekey, countykey, citykey, 0});
+   }
+
+   long mixed(Integer nationkey, Integer statekey, Integer countykey, Integer citykey)
+   {
+      return route(MIXED, sort_key_t{nationkey, statekey, countykey, citykey, 0});
+   }
+
+   long distinct(Integer nationkey, Integer statekey, Integer countykey, Integer citykey)
+   {
+      return route(DISTINCT, sort_key_t{nationkey, statekey, countykey, citykey, 0});
+   }
+
+   void insert1() { workload.maintain_all(); }
+   bool erase1() { return workload.erase_all(); }
+   void cleanup_updates() { workload.cleanup_all(); }
+   double get_size() { return workload.get_view_size() + workload.get_merged_size(); }
+   void select_to_insert() { workload.select_to_insert(); }
+   bool view_deltas_due() { return workload.view_deltas_due() || (customer2_flush_requested && !workload.customer_deltas.empty()); }
+   void fold_view_deltas()
+   {
+      workload.apply_pending_view_changes();
+      customer2_flush_requested = false;
+   }
+
+  private:
+   static bool reads_customer2(size_t path) { return path == BASE || path == HASH; }
+
+   static size_t depth_of(const sort_key_t& sk)
+   {
+      const auto fields = sort_key_t::hierarchy::values(sk);
+      size_t depth = 1;
+      while (depth < DEPTHS && fields[depth] != 0) {
+         depth++;
+      }
+      return depth;
+   }
+
+   long route(QueryKind kind, const sort_key_t& sk)
+   {
+      const size_t cls = kind * DEPTHS + depth_of(sk) - 1;
+      std::bitset<PATHS> allowed;
+      allowed.set();
+      if (FLAGS_maintenance_batch > 0 && !workload.customer_deltas.empty()) {
+         for (size_t p = 0; p < PATHS; p++) {
+            allowed[p] = !reads_customer2(p);
+         }
+         customer2_flush_requested = true;
+      }
+      const size_t path = router.choose(cls, allowed);
+      const auto expected = router.estimate(path, cls);
+      const auto start = std::chrono::steady_clock::now();
+      const long result = run(static_cast<Path>(path), kind, sk);
+      const double elapsed_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+      router.observe(path, cls, elapsed_ns);
+      plans << kind_names[kind] << "," << sk.nationkey << "," << sk.statekey << "," << sk.countykey << "," << sk.citykey << "," << path_names[path]
+            << "," << expected.ns << "," << expected.measured << "," << elapsed_ns << "," << result << "\n";
+      return result;
+   }
+
+   long run(Path path, QueryKind kind, const sort_key_t& sk)
+   {
+      if (kind == JOIN) {
+         switch (path) {
+            case BASE:
+               return workload.range_query_by_base(sk.nationkey, sk.statekey, sk.countykey, sk.citykey);
+            case VIEW:
+               return workload.range_query_by_view(sk.nationkey, sk.statekey, sk.countykey, sk.citykey);
+            case MERGED:
+               return workload.range_query_by_merged(sk.nationkey, sk.statekey, sk.countykey, sk.citykey);
+            default:
+               return workload.range_query_hash(sk.nationkey, sk.statekey, sk.countykey, sk.citykey);
+         }
+      }
+      const bool distinct = kind == DISTINCT;
+      switch (path) {
+         case BASE:
+            return workload.range_mixed_query_by_base(sk, distinct);
+         case VIEW:
+            return workload.range_mixed_query_by_view(sk, distinct);
+         case MERGED:
+            return workload.range_mixed_query_by_merged(sk, distinct);
+         default:
+            return workload.range_mixed_query_hash(sk, distinct);
+      }
+   }
+
+   void set_priors()
+   {
+      constexpr double PAGES_PER_MIB = 1024.0 * 1024.0 / 4096.0;
+      const double indexes = workload.get_indexes_size();
+      const double merged = workload.get_merged_size();
+      const double join_view = workload.get_join_view_size();
+      const double mixed_view = workload.get_mixed_view_size();
+      const double resident = std::min(1.0, FLAGS_dram_gib * 1024 / (workload.get_view_size() + merged));
+      const Params& params = this->get_params();
+      const std::array<double, DEPTHS> fanouts{static_cast<double>(params.nation_count), (params.state_max + 1) / 2.0,
+                                               (params.county_max + 1) / 2.0, (params.city_max + 1) / 2.0};
+      double selectivity = 1;
+      for (size_t depth = 1; depth <= DEPTHS; depth++) {
+         selectivity /= fanouts[depth - 1];
+         for (size_t kind = 0; kind < QUERY_KINDS; kind++) {
+            const size_t cls = kind * DEPTHS + depth - 1;
+            // (MiB, trees descended). The hash join reads what the base join reads and builds its tables on top, counted
+            // as one more descent, so that the merge join is preferred until both are measured
+            const std::array<std::pair<double, int>, PATHS> read{
+                std::pair{indexes, 5}, kind == MIXED ? std::pair{mixed_view, 2} : std::pair{join_view, 1}, std::pair{merged, 1}, std::pair{indexes, 6}};
+            for (size_t path = 0; path < PATHS; path++) {
+               router.set_prior(path, cls, read[path].first * PAGES_PER_MIB * selectivity + read[path].second, resident);
+            }
+         }
+      }
+   }
+};
+
 }  // namespace geo_join
\ No newline at end of file
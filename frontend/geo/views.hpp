@@ -1,6 +1,7 @@
 #pragma once
 
 #include <variant>
+#include "../shared/join_path.hpp"
 #include "../shared/variant_tuple_utils.hpp"
 #include "../shared/view_templates.hpp"
 #include "tpch_tables.hpp"
@@ -19,70 +20,18 @@ struct sort_key_t {
    ADD_KEY_TRAITS(&sort_key_t::nationkey, &sort_key_t::statekey, &sort_key_t::countykey, &sort_key_t::citykey, &sort_key_t::custkey)
    auto operator<=>(const sort_key_t&) const = default;
 
-   static sort_key_t max()
-   {
-      return sort_key_t{std::numeric_limits<Integer>::max(), std::numeric_limits<Integer>::max(), std::numeric_limits<Integer>::max(),
-                        std::numeric_limits<Integer>::max(), std::numeric_limits<Integer>::max()};
-   }
+   using hierarchy =
+       hierarchical_key<sort_key_t, &sort_key_t::nationkey, &sort_key_t::statekey, &sort_key_t::countykey, &sort_key_t::citykey, &sort_key_t::custkey>;
+
+   static sort_key_t max() { return hierarchy::max(); }
 
    friend int operator%(const sort_key_t& jk, const int& n) { return (jk.nationkey + jk.statekey + jk.countykey + jk.citykey) % n; }
 
-   std::vector<sort_key_t> matching_keys()
-   {
-      std::vector<sort_key_t> result;
-      if (custkey != 0) {
-         result.push_back(sort_key_t{nationkey, statekey, countykey, citykey, 0});
-      }
-      if (citykey != 0) {
-         result.push_back(sort_key_t{nationkey, statekey, countykey, 0, 0});
-      }
-      if (countykey != 0) {
-         result.push_back(sort_key_t{nationkey, statekey, 0, 0, 0});
-      }
-      if (statekey != 0) {
-         result.push_back(sort_key_t{nationkey, 0, 0, 0, 0});
-      }
-      result.push_back(*this);
-      return result;
-   }
+   std::vector<sort_key_t> matching_keys() { return hierarchy::matching_keys(*this); }
 
-   int match(const sort_key_t& other) const
-   {
-      // {0, 0, 0, 0, 0} cannot be used as wildcard
-      if (*this == sort_key_t{} && other == sort_key_t{})
-         return 0;
-      else if (*this == sort_key_t{})
-         return -1;
-      else if (other == sort_key_t{})
-         return 1;
-
-      if (nationkey != 0 && other.nationkey != 0 && nationkey != other.nationkey)
-         return nationkey - other.nationkey;
-      if (statekey != 0 && other.statekey != 0 && statekey != other.statekey)
-         return statekey - other.statekey;
-      if (countykey != 0 && other.countykey != 0 && countykey != other.countykey)
-         return countykey - other.countykey;
-      if (citykey != 0 && other.citykey != 0 && citykey != other.citykey)
-         return citykey - other.citykey;
-      if (custkey != 0 && other.custkey != 0 && custkey != other.custkey)
-         return custkey - other.custkey;
-      return 0;
-   }
+   int match(const sort_key_t& other) const { return hierarchy::match(*this, other); }
 
-   std::tuple<int, int, int> first_diff(const sort_key_t& base) const
-   {
-      if (nationkey != base.nationkey)
-         return std::make_tuple(0, base.nationkey, nationkey - base.nationkey);
-      if (statekey != base.statekey)
-         return std::make_tuple(1, base.statekey, statekey - base.statekey);
-      if (countykey != base.countykey)
-         return std::make_tuple(2, base.countykey, countykey - base.countykey);
-      if (citykey != base.citykey)
-         return std::make_tuple(3, base.citykey, citykey - base.citykey);
-      if (custkey != base.custkey)
-         return std::make_tuple(4, base.custkey, custkey - base.custkey);
-      return std::make_tuple(5, 0, 0);  // no difference
-   }
+   std::tuple<int, int, int> first_diff(const sort_key_t& base) const { return hierarchy::first_diff(*this, base); }
 };
 
 }  // namespace geo_join
@@ -558,8 +507,16 @@ struct view_t : public joined_t<24, sort_key_t, false, nation2_t, states_t, coun
    }
 };
 
+// The five-level geo hierarchy of the merged index
+using GeoPath = JoinPath<sort_key_t, nation2_t, states_t, county_t, city_t, customer2_t>;
+
 };  // namespace geo_join
 
+template <>
+struct join_path_of<geo_join::sort_key_t> {
+   using type = geo_join::GeoPath;
+};
+
 using namespace geo_join;
 
 template <>
@@ -582,84 +539,11 @@ struct SKBuilder<sort_key_t> {
       return sort_key_t{k.nationkey, k.statekey, k.countykey, k.citykey, 0};
    }
    static sort_key_t inline create(const mixed_view_t::Key& k, const mixed_view_t&) { return k.jk; }
-   static sort_key_t inline create(const std::variant<nation2_t::Key, states_t::Key, county_t::Key, city_t::Key, customer2_t::Key>& k,
-                                   const std::variant<nation2_t, states_t, county_t, city_t, customer2_t>& v)
+   // entries of merged indexes, e.g. GeoPath::MergedIndex
+   template <typename... Ks, typename... Vs>
+   static sort_key_t inline create(const std::variant<Ks...>& k, const std::variant<Vs...>& v)
    {
-      return std::visit(overloaded{[&](const nation2_t::Key& nk) {
-                                      const nation2_t* n = std::get_if<nation2_t>(&v);
-                                      return create(nk, *n);
-                                   },
-                                   [&](const states_t::Key& sk) {
-                                      const states_t* s = std::get_if<states_t>(&v);
-                                      return create(sk, *s);
-                                   },
-                                   [&](const county_t::Key& ck) {
-                                      const county_t* c = std::get_if<county_t>(&v);
-                                      return create(ck, *c);
-                                   },
-                                   [&](const city_t::Key& ci) {
-                                      const city_t* c = std::get_if<city_t>(&v);
-                                      return create(ci, *c);
-                                   },
-                                   [&](const customer2_t::Key& cu) {
-                                      const customer2_t* c = std::get_if<customer2_t>(&v);
-                                      return create(cu, *c);
-                                   }},
-                        k);
-   }
-   static sort_key_t inline create(const std::variant<nation2_t::Key, states_t::Key, county_t::Key, city_t::Key, customer_count_t::Key>& k,
-                                   const std::variant<nation2_t, states_t, county_t, city_t, customer_count_t>& v)
-   {
-      return std::visit(overloaded{[&](const nation2_t::Key& nk) {
-                                      const nation2_t* n = std::get_if<nation2_t>(&v);
-                                      return create(nk, *n);
-                                   },
-                                   [&](const states_t::Key& sk) {
-                                      const states_t* s = std::get_if<states_t>(&v);
-                                      return create(sk, *s);
-                                   },
-                                   [&](const county_t::Key& ck) {
-                                      const county_t* c = std::get_if<county_t>(&v);
-                                      return create(ck, *c);
-                                   },
-                                   [&](const city_t::Key& ci) {
-                                      const city_t* c = std::get_if<city_t>(&v);
-                                      return create(ci, *c);
-                                   },
-                                   [&](const customer_count_t::Key& cu) {
-                                      const customer_count_t* c = std::get_if<customer_count_t>(&v);
-                                      return create(cu, *c);
-                                   }},
-                        k);
-   }
-   static sort_key_t inline create(const std::variant<nation2_t::Key, states_t::Key>& k, const std::variant<nation2_t, states_t>& v)
-   {
-      return std::visit(overloaded{[&](const nation2_t::Key& nk) {
-                                      const nation2_t* n = std::get_if<nation2_t>(&v);
-                                      return create(nk, *n);
-                                   },
-                                   [&](const states_t::Key& sk) {
-                                      const states_t* s = std::get_if<states_t>(&v);
-                                      return create(sk, *s);
-                                   }},
-                        k);
-   }
-   static sort_key_t inline create(const std::variant<county_t::Key, city_t::Key, customer2_t::Key>& k,
-                                   const std::variant<county_t, city_t, customer2_t>& v)
-   {
-      return std::visit(overloaded{[&](const county_t::Key& ck) {
-                                      const county_t* c = std::get_if<county_t>(&v);
-                                      return create(ck, *c);
-                                   },
-                                   [&](const city_t::Key& ci) {
-                                      const city_t* c = std::get_if<city_t>(&v);
-                                      return create(ci, *c);
-                                   },
-                                   [&](const customer2_t::Key& cu) {
-                                      const customer2_t* c = std::get_if<customer2_t>(&v);
-                                      return create(cu, *c);
-                                   }},
-                        k);
+      return visit_entry(k, v, [](const auto& key, const auto& record) { return create(key, record); });
    }
 
    template <typename Record>
@@ -672,13 +556,13 @@ struct SKBuilder<sort_key_t> {
 template <>
 inline sort_key_t SKBuilder<sort_key_t>::get<nation2_t>(const sort_key_t& jk)
 {
-   return sort_key_t{jk.nationkey, 0, 0, 0, 0};
+   return GeoPath::prefix_of<nation2_t>(jk);
 }
 
 template <>
 inline sort_key_t SKBuilder<sort_key_t>::get<states_t>(const sort_key_t& jk)
 {
-   return sort_key_t{jk.nationkey, jk.statekey, 0, 0, 0};
+   return GeoPath::prefix_of<states_t>(jk);
 }
 
 template <>
@@ -690,7 +574,7 @@ inline sort_key_t SKBuilder<sort_key_t>::get<ns_t>(const sort_key_t& jk)
 template <>
 inline sort_key_t SKBuilder<sort_key_t>::get<county_t>(const sort_key_t& jk)
 {
-   return sort_key_t{jk.nationkey, jk.statekey, jk.countykey, 0, 0};
+   return GeoPath::prefix_of<county_t>(jk);
 }
 
 template <>
@@ -702,7 +586,7 @@ inline sort_key_t SKBuilder<sort_key_t>::get<nsc_t>(const sort_key_t& jk)
 template <>
 inline sort_key_t SKBuilder<sort_key_t>::get<city_t>(const sort_key_t& jk)
 {
-   return sort_key_t{jk.nationkey, jk.statekey, jk.countykey, jk.citykey, 0};
+   return GeoPath::prefix_of<city_t>(jk);
 }
 
 template <>
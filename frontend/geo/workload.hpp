@@ -1,10 +1,20 @@
 #pragma once
 
+#include "../shared/delta_batch.hpp"
+#include "../shared/result_cache.hpp"
+#include "../shared/tx_hooks.hpp"
+#include "../shared/view_delta.hpp"
 #include "load.hpp"
 #include "tpch_workload.hpp"
 #include "views.hpp"
 #include "workload_helpers.hpp"
 
+DECLARE_int32(maintenance_batch);
+DECLARE_bool(deferred_view_maintenance);
+DECLARE_int32(view_delta_max_rows);
+DECLARE_int32(view_delta_max_staleness_ms);
+DECLARE_int32(result_cache_entries);
+
 namespace geo_join
 {
 
@@ -14,6 +24,8 @@ template <template <typename> class AdapterType,
           template <typename...> class MergedScannerType>
 struct GeoJoinWrapper;  // forward declaration
 
+enum QueryKind : size_t { JOIN, MIXED, DISTINCT, QUERY_KINDS };
+
 template <template <typename> class AdapterType,
           template <typename...> class MergedAdapterType,
           template <typename> class ScannerType,
@@ -23,7 +35,7 @@ class GeoJoin
    friend struct GeoJoinWrapper<AdapterType, MergedAdapterType, ScannerType, MergedScannerType>;
    using TPCH = TPCHWorkload<AdapterType>;
    TPCH& workload;
-   using MergedTree = MergedAdapterType<nation2_t, states_t, county_t, city_t, customer2_t>;
+   using MergedTree = GeoPath::MergedIndex<MergedAdapterType>;
 
    MergedTree& merged;
 
@@ -98,6 +110,7 @@ class GeoJoin
    long range_query_by_merged(Integer nationkey, Integer statekey, Integer countykey, Integer citykey);
    long range_query_by_base(Integer nationkey, Integer statekey, Integer countykey, Integer citykey);
    long range_query_hash(Integer nationkey, Integer statekey, Integer countykey, Integer citykey);
+   long range_query_parallel_hash(Integer nationkey, Integer statekey, Integer countykey, Integer citykey);
 
    std::pair<int, bool> get_n(bool info_only = false) const
    {
@@ -129,6 +142,47 @@ class GeoJoin
       return std::make_pair(n, n_i == nation_keys.size());
    }
 
+   // Results of the queries by (QueryKind, selection) with --result_cache_entries, invalidated by every customer change
+   PrefixResultCache<sort_key_t, long, QUERY_KINDS> result_cache{static_cast<size_t>(std::max(FLAGS_result_cache_entries, 0))};
+
+   // Result of the query `kind` over sk, computed by run() on a miss. On a miss the selection is extended to the first
+   // city at or after it, as the queries extend it (see update_sk), so that the entry is invalidated by the changes it
+   // covers; hits find it by sk as given.
+   template <typename Run>
+   long cached_result(QueryKind kind, const sort_key_t& sk, Run&& run)
+   {
+      if (!result_cache.enabled()) {
+         return run();
+      }
+      const u64 ticket = TxHooks::snapshot_epoch();
+      auto cached = result_cache.lookup(kind, sk);
+      if (cached.value.has_value()) {
+         return *cached.value;
+      }
+      if (!cached.selection.has_value()) {
+         cached.selection = sk;
+         city.scan(
+             city_t::Key{sk},
+             [&](const city_t::Key& cik, const city_t& civ) {
+                sort_key_t::hierarchy::fill_selected(*cached.selection, SKBuilder<sort_key_t>::create(cik, civ));
+                return false;
+             },
+             []() {});
+      }
+      const long result = run();
+      result_cache.insert(kind, sk, *cached.selection, result, ticket);
+      return result;
+   }
+
+   // Drops the cached results over sk once the running transaction committed, before which readers can still
+   // cache results without the change
+   void invalidate_cached(const sort_key_t& sk)
+   {
+      if (result_cache.enabled()) {
+         TxHooks::on_commit([this, sk]() { invalidate_cached(sk); });
+      }
+   }
+
    // -------------------------------------------------------------
    // ---------------------- MAINTAIN -----------------------------
    MaintenanceState maintenance_state;
@@ -140,32 +194,78 @@ class GeoJoin
    void maintain_base();
    void maintain_merged();
    void maintain_view();
+   void maintain_view(const sort_key_t& sk, const customer2_t& cuv);
 
    bool erase_base();
    bool erase_merged();
    bool erase_view();
+   void erase_view(const sort_key_t& sk);
+
+   // The same customer in all structures, for the query router (--storage_structure=6)
+   void maintain_all();
+   bool erase_all();
+
+   // View maintenance epoch with --maintenance_batch: the customer changes of the epoch, applied by
+   // flush_view_deltas() in key order to customer2, join_view and cust_count_view
+   DeltaBatch<customer2_t> customer_deltas;
+   void flush_view_deltas();
+
+   // Deferred view maintenance with --deferred_view_maintenance: customer2 is written at once, the changes of
+   // join_view and cust_count_view wait in memory, are merged into the view queries and folded into the views by
+   // fold_view_deltas() once view_deltas_due(), by the writer or by the background worker in between its transactions
+   PendingRows<view_t> join_view_delta;
+   PendingCounts<customer_count_t> cust_count_delta;
+   bool view_deltas_due() const
+   {
+      if (!FLAGS_deferred_view_maintenance) {
+         return false;
+      }
+      const size_t pending = std::max(join_view_delta.size(), cust_count_delta.size());
+      const auto staleness = std::max(join_view_delta.staleness(), cust_count_delta.staleness());
+      return pending >= static_cast<size_t>(FLAGS_view_delta_max_rows) ||
+             (pending > 0 && staleness >= std::chrono::milliseconds(FLAGS_view_delta_max_staleness_ms));
+   }
+   void fold_view_deltas();
+   // add(v) for the join_view rows of the selection sk, which the first row extends like update_sk. The selection and
+   // add() run in the leaves (scanFiltered), unless the pending rows of deferred maintenance have to be merged in
+   template <typename Add>
+   void scan_join_view(sort_key_t& sk, Add&& add);
 
    void cleanup_base()
    {
-      maintenance_state.cleanup([this](const sort_key_t& sk) { customer2.erase(customer2_t::Key{sk}); });
+      maintenance_state.cleanup([this](const sort_key_t& sk) {
+         customer2.erase(customer2_t::Key{sk});
+         invalidate_cached(sk);
+      });
    }
    void cleanup_merged()
    {
-      maintenance_state.cleanup([this](const sort_key_t& sk) { merged.template erase<customer2_t>(customer2_t::Key{sk}); });
+      maintenance_state.cleanup([this](const sort_key_t& sk) {
+         merged.template erase<customer2_t>(customer2_t::Key{sk});
+         invalidate_cached(sk);
+      });
    }
    void cleanup_view()
+   {
+      maintenance_state.cleanup([this](const sort_key_t& sk) { erase_view(sk); });
+      apply_pending_view_changes();
+   }
+   void cleanup_all()
    {
       maintenance_state.cleanup([this](const sort_key_t& sk) {
-         bool ret_jv = join_view.erase(view_t::Key{sk});
-         bool ret_c = customer2.erase(customer2_t::Key{sk});
-         if (!ret_jv || !ret_c) {
-            std::stringstream ss;
-            ss << "Error erasing customer in view, ret_jv: " << ret_jv << ", ret_c: " << ret_c << ", sk: " << sk;
-            throw std::runtime_error(ss.str());
-         }
-         customer_count_t::Key cuc_k{sk};
-         cust_count_view.update1(cuc_k, [](customer_count_t& v) { v.customer_count--; });
+         erase_view(sk);
+         merged.template erase<customer2_t>(customer2_t::Key{sk});
+         invalidate_cached(sk);
       });
+      apply_pending_view_changes();
+   }
+   void apply_pending_view_changes()
+   {
+      if (FLAGS_deferred_view_maintenance) {
+         fold_view_deltas();
+      } else if (FLAGS_maintenance_batch > 0) {
+         flush_view_deltas();
+      }
    }
 
    // -------------------------------------------------------------
@@ -204,6 +304,18 @@ class GeoJoin
       return merged_size;
    }
 
+   double get_join_view_size()
+   {
+      static auto join_view_size = join_view.size();
+      return join_view_size;
+   }
+
+   double get_mixed_view_size()  // what the non-distinct mixed queries read instead of join_view
+   {
+      static auto mixed_view_size = geo_view.size() + cust_count_view.size();
+      return mixed_view_size;
+   }
+
    void log_sizes();
 
    // -------------------------------------------------------------
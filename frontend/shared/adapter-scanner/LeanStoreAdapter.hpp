@@ -226,6 +226,33 @@ struct LeanStoreAdapter : Adapter<Record> {
       }
    }
    // -------------------------------------------------------------------------------------
+   // scan() with the filtering pushed into the leaves: past_end(key, key_length) and keep(key, key_length, payload) see the
+   // folded key and the payload in place, under the guard of the leaf. The scan stops at the first entry past_end()
+   // without calling back, and only the entries that keep() accepts are unfolded and passed to cb.
+   template <typename PastEnd, typename Keep, typename CB>
+   void scanFiltered(const typename Record::Key& key, PastEnd&& past_end, Keep&& keep, CB&& cb)
+   {
+      u8 folded_key[Record::maxFoldLength()];
+      u16 folded_key_len = Record::foldKey(folded_key, key);
+      OP_RESULT ret = btree->scanAsc(
+          folded_key, folded_key_len,
+          [&](const u8* key, u16 key_length, const u8* payload, u16) {
+             if (key_length != folded_key_len || past_end(key, key_length)) {
+                return false;
+             }
+             if (!keep(key, key_length, payload)) {
+                return true;
+             }
+             typename Record::Key typed_key;
+             Record::unfoldKey(key, typed_key);
+             return cb(typed_key, *reinterpret_cast<const Record*>(payload));
+          },
+          []() {});
+      if (ret == leanstore::OP_RESULT::ABORT_TX) {
+         cr::Worker::my().abortTX();
+      }
+   }
+   // -------------------------------------------------------------------------------------
    template <class Field>
    Field lookupField(const typename Record::Key& key, Field Record::* f)
    {
@@ -250,8 +277,8 @@ struct LeanStoreAdapter : Adapter<Record> {
    {
       std::unique_ptr<LeanStoreScanner<Record>> scanner;
       if (FLAGS_vi) {
-         scanner = std::make_unique<LeanStoreScanner<Record>>(
-             *static_cast<leanstore::storage::btree::BTreeGeneric*>(dynamic_cast<leanstore::storage::btree::BTreeVI*>(btree)));
+         auto* vi = dynamic_cast<leanstore::storage::btree::BTreeVI*>(btree);
+         scanner = std::make_unique<LeanStoreScanner<Record>>(*static_cast<leanstore::storage::btree::BTreeGeneric*>(vi), vi);
       } else {
          scanner = std::make_unique<LeanStoreScanner<Record>>(
              *static_cast<leanstore::storage::btree::BTreeGeneric*>(dynamic_cast<leanstore::storage::btree::BTreeLL*>(btree)));
@@ -1,6 +1,8 @@
 #pragma once
 // #include <stdexcept>
+#include <string>
 #include <variant>
+#include <vector>
 #include "Exceptions.hpp"
 #include "LeanStoreMergedScanner.hpp"
 #include "leanstore/KVInterface.hpp"
@@ -11,8 +13,10 @@ using namespace leanstore;
 
 template <typename... Records>
 struct LeanStoreMergedAdapter {
-   leanstore::KVInterface* btree;
-   leanstore::storage::btree::BTreeGeneric* btree_generic;
+   // Range partitions, each an independent B-tree: partitions[p] holds the folded keys from lower_bounds[p - 1] on (see
+   // partition_of_key), so that writers and scanners of different ranges never latch the same nodes
+   std::vector<leanstore::KVInterface*> partitions;
+   std::vector<std::string> lower_bounds;
    string name;
    u64 produced;
 
@@ -21,25 +25,39 @@ struct LeanStoreMergedAdapter {
       // hack
    }
 
-   LeanStoreMergedAdapter(LeanStore& db, string name) : name(name), produced(0)
+   // lower_bounds: folded first keys of the partitions after the first, ascending; none for a single B-tree
+   LeanStoreMergedAdapter(LeanStore& db, string name, std::vector<std::string> lower_bounds = {})
+       : lower_bounds(std::move(lower_bounds)), name(name), produced(0)
    {
-      if (FLAGS_vi) {
-         if (FLAGS_recover) {
-            btree = &db.retrieveBTreeVI(name);
+      for (size_t p = 0; p <= this->lower_bounds.size(); p++) {
+         const string partition_name = p == 0 ? name : name + "_p" + std::to_string(p);
+         if (FLAGS_vi) {
+            if (FLAGS_recover) {
+               partitions.push_back(&db.retrieveBTreeVI(partition_name));
+            } else {
+               partitions.push_back(&db.registerBTreeVI(partition_name, {.enable_wal = FLAGS_wal, .use_bulk_insert = false}));
+            }
          } else {
-            btree = &db.registerBTreeVI(name, {.enable_wal = FLAGS_wal, .use_bulk_insert = false});
-         }
-      } else {
-         if (FLAGS_recover) {
-            btree = &db.retrieveBTreeLL(name);
-         } else {
-            btree = &db.registerBTreeLL(name, {.enable_wal = FLAGS_wal, .use_bulk_insert = false});
+            if (FLAGS_recover) {
+               partitions.push_back(&db.retrieveBTreeLL(partition_name));
+            } else {
+               partitions.push_back(&db.registerBTreeLL(partition_name, {.enable_wal = FLAGS_wal, .use_bulk_insert = false}));
+            }
          }
       }
-      btree_generic = static_cast<leanstore::storage::btree::BTreeGeneric*>(dynamic_cast<leanstore::storage::btree::BTreeLL*>(btree));
    }
 
-   void printTreeHeight() { cout << name << " height = " << btree->getHeight() << endl; }
+   leanstore::KVInterface* btree_of(const u8* folded_key, u16 folded_key_len)
+   {
+      return partitions.size() == 1 ? partitions[0] : partitions[partition_of_key(lower_bounds, folded_key, folded_key_len)];
+   }
+
+   void printTreeHeight()
+   {
+      for (size_t p = 0; p < partitions.size(); p++) {
+         cout << name << (partitions.size() > 1 ? " partition " + std::to_string(p) : "") << " height = " << partitions[p]->getHeight() << endl;
+      }
+   }
    // -------------------------------------------------------------------------------------
    // Record must be one of the Records
    template <class Record>
@@ -47,7 +65,7 @@ struct LeanStoreMergedAdapter {
    {
       u8 folded_key[Record::maxFoldLength()];
       u16 folded_key_len = Record::foldKey(folded_key, key);
-      const OP_RESULT res = btree->insert(folded_key, folded_key_len, (u8*)(&record), sizeof(Record));
+      const OP_RESULT res = btree_of(folded_key, folded_key_len)->insert(folded_key, folded_key_len, (u8*)(&record), sizeof(Record));
       if (res != leanstore::OP_RESULT::OK && res != leanstore::OP_RESULT::ABORT_TX) {
          std::cerr << "LeanStoreMergedAdapter::insert failed with res value " << std::to_string((int)res) << ", key: " << key << std::endl;
          // print hex
@@ -72,7 +90,7 @@ struct LeanStoreMergedAdapter {
    {
       u8 folded_key[Record::maxFoldLength()];
       u16 folded_key_len = Record::foldKey(folded_key, key);
-      const OP_RESULT res = btree->lookup(folded_key, folded_key_len, [&](const u8* payload, u16 payload_length) {
+      const OP_RESULT res = btree_of(folded_key, folded_key_len)->lookup(folded_key, folded_key_len, [&](const u8* payload, u16 payload_length) {
          static_cast<void>(payload_length);
          assert(payload_length == sizeof(Record));
          const Record& typed_payload = *reinterpret_cast<const Record*>(payload);
@@ -89,7 +107,7 @@ struct LeanStoreMergedAdapter {
    {
       u8 folded_key[Record::maxFoldLength()];
       u16 folded_key_len = Record::foldKey(folded_key, key);
-      const OP_RESULT res = btree->tryLookup(folded_key, folded_key_len, [&](const u8* payload, u16 payload_length) {
+      const OP_RESULT res = btree_of(folded_key, folded_key_len)->tryLookup(folded_key, folded_key_len, [&](const u8* payload, u16 payload_length) {
          static_cast<void>(payload_length);
          assert(payload_length == sizeof(Record));
          const Record& typed_payload = *reinterpret_cast<const Record*>(payload);
@@ -131,7 +149,7 @@ struct LeanStoreMergedAdapter {
    {
       u8 folded_jk[JK::maxFoldLength()];
       u16 folded_jk_len = JK::keyfold(folded_jk, jk);
-      const OP_RESULT res = btree->tryLookup(folded_jk, folded_jk_len, [&](const u8* payload, u16 payload_length) {
+      const OP_RESULT res = btree_of(folded_jk, folded_jk_len)->tryLookup(folded_jk, folded_jk_len, [&](const u8* payload, u16 payload_length) {
          static_cast<void>(payload_length);
          auto [key, rec] = toType<Records...>(jk, payload);
          cb(rec);
@@ -161,7 +179,7 @@ struct LeanStoreMergedAdapter {
          update_descriptor.slots[0].length = sizeof(Record);
       }
       // -------------------------------------------------------------------------------------
-      const OP_RESULT res = btree->updateSameSizeInPlace(
+      const OP_RESULT res = btree_of(folded_key, folded_key_len)->updateSameSizeInPlace(
           folded_key, folded_key_len,
           [&](u8* payload, u16 payload_length) {
              static_cast<void>(payload_length);
@@ -181,7 +199,7 @@ struct LeanStoreMergedAdapter {
    {
       u8 folded_key[Record::maxFoldLength()];
       u16 folded_key_len = Record::foldKey(folded_key, key);
-      const auto res = btree->remove(folded_key, folded_key_len);
+      const auto res = btree_of(folded_key, folded_key_len)->remove(folded_key, folded_key_len);
       if (res == leanstore::OP_RESULT::ABORT_TX) {
          cr::Worker::my().abortTX();
       }
@@ -194,7 +212,7 @@ struct LeanStoreMergedAdapter {
       u8 folded_key[Record::maxFoldLength()];
       u16 folded_key_len = Record::foldKey(folded_key, key);
       Field local_f;
-      const OP_RESULT res = btree->lookup(folded_key, folded_key_len, [&](const u8* payload, u16 payload_length) {
+      const OP_RESULT res = btree_of(folded_key, folded_key_len)->lookup(folded_key, folded_key_len, [&](const u8* payload, u16 payload_length) {
          static_cast<void>(payload_length);
          Record& typed_payload = *const_cast<Record*>(reinterpret_cast<const Record*>(payload));
          local_f = (typed_payload).*f;
@@ -206,33 +224,61 @@ struct LeanStoreMergedAdapter {
       return local_f;
    }
    // -------------------------------------------------------------------------------------
-   u64 count() { return btree->countEntries(); }
+   u64 count()
+   {
+      u64 c = 0;
+      for (auto* btree : partitions) {
+         c += btree->countEntries();
+      }
+      return c;
+   }
 
-   u64 estimatePages() { return btree->estimatePages(); }
+   u64 estimatePages()
+   {
+      u64 pages = 0;
+      for (auto* btree : partitions) {
+         pages += btree->estimatePages();
+      }
+      return pages;
+   }
    double size()
    {
-      double s = btree->estimatePages() * EFFECTIVE_PAGE_SIZE / 1024.0 / 1024.0;
+      double s = estimatePages() * EFFECTIVE_PAGE_SIZE / 1024.0 / 1024.0;
       return s;
    }
-   u64 estimateLeafs() { return btree->estimateLeafs(); }
+   u64 estimateLeafs()
+   {
+      u64 leafs = 0;
+      for (auto* btree : partitions) {
+         leafs += btree->estimateLeafs();
+      }
+      return leafs;
+   }
 
    template <typename JK, typename JR>
    std::unique_ptr<LeanStoreMergedScanner<JK, JR, Records...>> getScanner() {
-      if (FLAGS_vi) {
-         return std::make_unique<LeanStoreMergedScanner<JK, JR, Records...>>(*static_cast<leanstore::storage::btree::BTreeGeneric*>(dynamic_cast<leanstore::storage::btree::BTreeVI*>(btree)));
-      } else {
-         return std::make_unique<LeanStoreMergedScanner<JK, JR, Records...>>(*static_cast<leanstore::storage::btree::BTreeGeneric*>(dynamic_cast<leanstore::storage::btree::BTreeLL*>(btree)));
-      }
+      return std::make_unique<LeanStoreMergedScanner<JK, JR, Records...>>(scanned_partitions(), &lower_bounds);
    }
 
    template <typename JK, typename JR, typename... RsSubset>
    std::unique_ptr<LeanStoreMergedScanner<JK, JR, RsSubset...>> getSelectiveScanner()
    {
-      if (FLAGS_vi) {
-         return std::make_unique<LeanStoreMergedScanner<JK, JR, RsSubset...>>(*static_cast<leanstore::storage::btree::BTreeGeneric*>(dynamic_cast<leanstore::storage::btree::BTreeVI*>(btree)));
-      } else {
-         return std::make_unique<LeanStoreMergedScanner<JK, JR, RsSubset...>>(*static_cast<leanstore::storage::btree::BTreeGeneric*>(dynamic_cast<leanstore::storage::btree::BTreeLL*>(btree)));
+      return std::make_unique<LeanStoreMergedScanner<JK, JR, RsSubset...>>(scanned_partitions(), &lower_bounds);
+   }
+
+  private:
+   std::vector<LeanStoreMergedPartition> scanned_partitions()
+   {
+      std::vector<LeanStoreMergedPartition> scanned;
+      for (auto* btree : partitions) {
+         if (FLAGS_vi) {
+            auto* vi = dynamic_cast<leanstore::storage::btree::BTreeVI*>(btree);
+            scanned.push_back({static_cast<leanstore::storage::btree::BTreeGeneric*>(vi), vi});
+         } else {
+            scanned.push_back({static_cast<leanstore::storage::btree::BTreeGeneric*>(dynamic_cast<leanstore::storage::btree::BTreeLL*>(btree))});
+         }
       }
+      return scanned;
    }
 
 };
\ No newline at end of file
@@ -1,57 +1,184 @@
 #pragma once
 
 
+#include <algorithm>
+#include <array>
+#include <cstring>
 #include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../scan_batch.hpp"
 #include "../variant_utils.hpp"
+#include "LeanStoreSnapshotCursor.hpp"
 #include "leanstore/KVInterface.hpp"
 #include "leanstore/storage/btree/core/BTreeGeneric.hpp"
 #include "leanstore/storage/btree/core/BTreeGenericIterator.hpp"
 
+// B-tree of a merged index; vi is the same tree when it is versioned
+struct LeanStoreMergedPartition {
+   leanstore::storage::btree::BTreeGeneric* btree;
+   leanstore::storage::btree::BTreeVI* vi = nullptr;
+};
+
+// Range partition of a folded key: partition p > 0 holds the keys from lower_bounds[p - 1] on
+inline size_t partition_of_key(const std::vector<std::string>& lower_bounds, const u8* key, unsigned key_length)
+{
+   const std::string_view k(reinterpret_cast<const char*>(key), key_length);
+   return std::upper_bound(lower_bounds.begin(), lower_bounds.end(), k) - lower_bounds.begin();
+}
+
 template <typename JK, typename JR, typename... Records>
 struct LeanStoreMergedScanner
 {
    using BTreeIt = leanstore::storage::btree::BTreeSharedIterator;
    using BTree = leanstore::storage::btree::BTreeGeneric;
+   // A range-partitioned merged index is scanned as the concatenation of its partitions: seeks go to the partition of
+   // their key and moves continue in the neighboring partition at either end
+   std::vector<LeanStoreMergedPartition> partitions;
+   const std::vector<std::string>* lower_bounds = nullptr;  // see partition_of_key, only with several partitions
+   size_t partition = 0;
    std::unique_ptr<BTreeIt> it;
+   LeanStoreSnapshotCursor snapshot;
 
    bool after_seek = false;
-   long long produced = 0;
+   long long produced = 0;  // see LeanStoreScanner::produced
+
+   // The merged records have distinct key lengths, so the slot array of a leaf alone tells the type of every
+   // entry. For skipToNextOfType(), the scanner keeps a directory of the current leaf: next_of_type[t][i] is
+   // the first slot >= i holding a Records[t] entry (count if there is none).
+   static constexpr std::array<unsigned, sizeof...(Records)> key_lengths{Records::maxFoldLength()...};
+   static constexpr bool keys_identify_type = []() {
+      for (size_t i = 0; i < key_lengths.size(); i++) {
+         for (size_t j = i + 1; j < key_lengths.size(); j++) {
+            if (key_lengths[i] == key_lengths[j]) {
+               return false;
+            }
+         }
+      }
+      return true;
+   }();
+   struct TypeDirectory {
+      const void* bf = nullptr;  // leaf and latch version the directory was built for
+      u64 version = 0;
+      std::array<std::vector<u16>, sizeof...(Records)> next_of_type;
+   } directory;
+
+   // vi: the same tree when it is versioned, so that entries are resolved against the active snapshot
+   LeanStoreMergedScanner(BTree& btree, leanstore::storage::btree::BTreeVI* vi = nullptr)
+       : LeanStoreMergedScanner(std::vector<LeanStoreMergedPartition>{{&btree, vi}}, nullptr)
+   {
+   }
 
-   LeanStoreMergedScanner(BTree& btree) : it(std::make_unique<leanstore::storage::btree::BTreeSharedIterator>(btree)) { reset(); }
+   LeanStoreMergedScanner(std::vector<LeanStoreMergedPartition> parts, const std::vector<std::string>* lower_bounds)
+       : partitions(std::move(parts)),
+         lower_bounds(lower_bounds),
+         it(std::make_unique<leanstore::storage::btree::BTreeSharedIterator>(*partitions[0].btree)),
+         snapshot(partitions[0].vi)
+   {
+      reset();
+   }
 
    ~LeanStoreMergedScanner() = default;
 
    void reset()
    {
+      if (partition != 0) {
+         enter(0);
+      }
       it->reset();
+      snapshot.reset();
       this->produced = 0;
    }
 
    std::optional<std::pair<std::variant<typename Records::Key...>, std::variant<Records...>>> next()
    {
+      leanstore::OP_RESULT res = leanstore::OP_RESULT::OK;
       if (after_seek) {
          after_seek = false;
-         return current();
+      } else {
+         res = step();
+         this->produced++;
       }
-      const leanstore::OP_RESULT res = it->next();
-      if (res != leanstore::OP_RESULT::OK) {
-         return std::nullopt;
+      while (res == leanstore::OP_RESULT::OK) {
+         auto kv = this->current();
+         if (kv) {
+            return kv;
+         }
+         res = step();  // not in the snapshot
+         this->produced++;
       }
-      this->produced++;
-      return this->current();
+      return std::nullopt;
+   }
+
+   // Same positioning as repeated next() calls, the iterator stays on the last returned entry
+   template <size_t N>
+   size_t next_batch(ScanBatch<std::variant<typename Records::Key...>, std::variant<Records...>, N>& batch)
+   {
+      batch.clear();
+      while (!batch.full()) {
+         leanstore::OP_RESULT res = leanstore::OP_RESULT::OK;
+         if (after_seek) {
+            after_seek = false;
+         } else {
+            res = step();
+            this->produced++;
+         }
+         if (res != leanstore::OP_RESULT::OK) {
+            break;
+         }
+         if (it->cur == -1 && !snapshot.on_graveyard) {
+            continue;
+         }
+         snapshot.read(snapshot.at(*it), [&](leanstore::Slice key, leanstore::Slice payload) {
+            assignType<Records...>(key, payload, batch.keys[batch.size], batch.records[batch.size]);
+            batch.size++;
+         });
+      }
+      return batch.size;
+   }
+
+   // Zero-copy scan, see LeanStoreScanner::for_each_view. cb(const Key&, const Record&) is called with the
+   // concrete types of each entry instead of variants, e.g. through a generic lambda
+   template <typename CB>
+   bool for_each_view(CB&& cb)
+   {
+      leanstore::OP_RESULT res = leanstore::OP_RESULT::OK;
+      if (after_seek) {
+         after_seek = false;
+      } else {
+         res = step();
+         this->produced++;
+      }
+      for (; res == leanstore::OP_RESULT::OK; res = step(), this->produced++) {
+         if (it->cur == -1 && !snapshot.on_graveyard) {
+            continue;
+         }
+         bool more = true;
+         snapshot.read(snapshot.at(*it), [&](leanstore::Slice key, leanstore::Slice payload) { more = visitType<Records...>(key, payload, cb); });
+         if (!more) {
+            return true;
+         }
+      }
+      return false;
    }
 
    std::optional<std::pair<std::variant<typename Records::Key...>, std::variant<Records...>>> prev()
    {
+      leanstore::OP_RESULT res = leanstore::OP_RESULT::OK;
       if (after_seek) {
          after_seek = false;
-         return current();
+      } else {
+         res = step_back();
       }
-      const leanstore::OP_RESULT res = it->prev();
-      if (res != leanstore::OP_RESULT::OK) {
-         return std::nullopt;
+      while (res == leanstore::OP_RESULT::OK) {
+         auto kv = this->current();
+         if (kv) {
+            return kv;
+         }
+         res = step_back();  // not in the snapshot
       }
-      return this->current();
+      return std::nullopt;
    }
 
    template <typename RecordType>
@@ -62,7 +189,7 @@ struct LeanStoreMergedScanner
       u8 keyBuffer[RecordType::maxFoldLength()];
       unsigned pos = RecordType::foldKey(keyBuffer, k);
       leanstore::Slice keySlice(keyBuffer, pos);
-      [[maybe_unused]] const leanstore::OP_RESULT res = it->seek(keySlice);  // keySlice as lowerbound
+      const leanstore::OP_RESULT res = seek_routed(keySlice);  // keySlice as lowerbound
       if (res != leanstore::OP_RESULT::OK) return; // last key, next will return std::nullopt
       after_seek = true;
    }
@@ -74,9 +201,9 @@ struct LeanStoreMergedScanner
       u8 keyBuffer[RecordType::maxFoldLength()];
       unsigned pos = RecordType::foldKey(keyBuffer, k);
       leanstore::Slice keySlice(keyBuffer, pos);
-      const leanstore::OP_RESULT res = it->seekForPrev(keySlice);
+      const leanstore::OP_RESULT res = seek_for_prev_routed(keySlice);
       if (res != leanstore::OP_RESULT::OK) {
-         it->reset();  // next() will return first key
+         reset();  // next() will return first key
          return;
       }
       after_seek = true;
@@ -88,12 +215,12 @@ struct LeanStoreMergedScanner
    {
       seekForPrev<RecordType>(k);
       while (true) {
-         auto kv = current().value();
-         if (std::holds_alternative<RecordType>(kv.second)) {
+         auto kv = current();
+         if (kv && std::holds_alternative<RecordType>(kv->second)) {
             after_seek = true;
             return true;
          }
-         leanstore::OP_RESULT ret = it->next();
+         leanstore::OP_RESULT ret = step();
          if (ret != leanstore::OP_RESULT::OK) {
             // std::cerr << "seekTyped: " << k << " returns " << (int) ret << std::endl;
             return false;
@@ -106,28 +233,78 @@ struct LeanStoreMergedScanner
       u8 keyBuffer[JK::maxFoldLength()];
       unsigned pos = JK::keyfold(keyBuffer, jk);
       leanstore::Slice keySlice(keyBuffer, pos);
-      [[maybe_unused]] const leanstore::OP_RESULT res = it->seek(keySlice);
+      const leanstore::OP_RESULT res = seek_routed(keySlice);
       if (res != leanstore::OP_RESULT::OK) return; // last key, next will return std::nullopt
       after_seek = true;
    }
 
    std::optional<std::pair<std::variant<typename Records::Key...>, std::variant<Records...>>> current()
    {
-      if (it->cur == -1) {
+      if (it->cur == -1 && !snapshot.on_graveyard) {
          return std::nullopt;
       }
-      it->assembleKey();
-      leanstore::Slice key = it->key();
-      leanstore::Slice payload = it->value();
-      return toType<Records...>(key, payload);
+      return read(snapshot.at(*it));
+   }
+
+   // Moves to the next RecordType entry in the current leaf without decoding the entries in between; next()
+   // returns it (or the first visible entry after it). False if the leaf has none, the scanner is unchanged then.
+   // Graveyard merges and fresh seeks are not skipped, callers fall back to seeking. The entries of the other types in
+   // between are passed over, so callers must not rely on it past the key they look for (see PremergedJoin::skip_filter_next).
+   template <typename RecordType>
+   bool skipToNextOfType()
+      requires std::disjunction_v<std::is_same<RecordType, Records>...>
+   {
+      if constexpr (!keys_identify_type) {
+         return false;
+      } else {
+         if (after_seek || it->cur < 0 || snapshot.on_graveyard || snapshot.merges_graveyard()) {
+            return false;
+         }
+         refresh_directory();
+         const u16 slot = directory.next_of_type[type_index<RecordType>()][it->cur + 1];
+         if (slot >= it->leaf->count) {
+            return false;
+         }
+         it->cur = slot;
+         after_seek = true;
+         return true;
+      }
    }
 
+   // Moves onto the entry after the last returned one without decoding it, unless a seek or skipToNextOfType()
+   // already did. folded_key() then reads that entry, next() returns it and consume() passes over it. False at the end
+   bool advance()
+   {
+      if (after_seek) {
+         return true;
+      }
+      if (step() != leanstore::OP_RESULT::OK) {
+         return false;
+      }
+      this->produced++;
+      after_seek = true;
+      return true;
+   }
+
+   // Copies the folded key of the entry next() returns first into out, 0 if the scanner is on none
+   unsigned folded_key(u8* out)
+   {
+      BTreeIt& at = snapshot.at(*it);
+      if (at.cur == -1) {
+         return 0;
+      }
+      at.leaf->copyFullKey(at.cur, out);
+      return at.leaf->getFullKeyLen(at.cur);
+   }
+
+   void consume() { after_seek = false; }
+
    std::optional<std::pair<std::variant<typename Records::Key...>, std::variant<Records...>>> last_in_page()
    {
       if (it->leaf->count > 0) {
          auto prev_cur = it->cur;
          it->cur = it->leaf->count - 1;
-         auto kv = current();
+         auto kv = read(*it);
          it->cur = prev_cur; // restore the cursor
          return kv;
       } else {
@@ -157,4 +334,120 @@ struct LeanStoreMergedScanner
    //    joiner.next_jk();
    //    return std::make_tuple(joiner.current_jk, joiner.produced);
    // }
-};
\ No newline at end of file
+
+  private:
+   static constexpr unsigned max_key_length = std::max({Records::maxFoldLength()...});
+
+   // Moves the cursor into partition p, unpositioned
+   void enter(size_t p)
+   {
+      partition = p;
+      it = std::make_unique<BTreeIt>(*partitions[p].btree);
+      snapshot = LeanStoreSnapshotCursor(partitions[p].vi);
+      it->reset();
+   }
+
+   // snapshot.next() over the partitions: past the last entry of one, on to the first of the next
+   leanstore::OP_RESULT step()
+   {
+      leanstore::OP_RESULT res = snapshot.next(*it);
+      while (res != leanstore::OP_RESULT::OK && partition + 1 < partitions.size()) {
+         enter(partition + 1);
+         res = snapshot.next(*it);
+      }
+      return res;
+   }
+
+   // snapshot.prev() over the partitions
+   leanstore::OP_RESULT step_back()
+   {
+      leanstore::OP_RESULT res = snapshot.prev(*it);
+      while (res != leanstore::OP_RESULT::OK && partition > 0) {
+         enter(partition - 1);
+         res = seek_last();
+      }
+      return res;
+   }
+
+   // Positions on the last entry of the current partition
+   leanstore::OP_RESULT seek_last()
+   {
+      u8 keyBuffer[max_key_length];
+      std::memset(keyBuffer, 0xFF, max_key_length);
+      leanstore::Slice keySlice(keyBuffer, max_key_length);
+      const leanstore::OP_RESULT res = it->seekForPrev(keySlice);
+      if (res == leanstore::OP_RESULT::OK) {
+         snapshot.seekedForPrev(*it, res, keySlice);
+      }
+      return res;
+   }
+
+   size_t partition_of(leanstore::Slice key) const { return partitions.size() == 1 ? 0 : partition_of_key(*lower_bounds, key.data(), key.length()); }
+
+   // Seeks the first entry >= key in the partition of key, or in the ones after it
+   leanstore::OP_RESULT seek_routed(leanstore::Slice key)
+   {
+      if (const size_t p = partition_of(key); p != partition) {
+         enter(p);
+      }
+      leanstore::OP_RESULT res = snapshot.seeked(*it, it->seek(key), key);
+      while (res != leanstore::OP_RESULT::OK && partition + 1 < partitions.size()) {
+         enter(partition + 1);
+         res = snapshot.next(*it);
+      }
+      return res;
+   }
+
+   // Seeks the last entry <= key in the partition of key, or in the ones before it
+   leanstore::OP_RESULT seek_for_prev_routed(leanstore::Slice key)
+   {
+      if (const size_t p = partition_of(key); p != partition) {
+         enter(p);
+      }
+      leanstore::OP_RESULT res = it->seekForPrev(key);
+      if (res == leanstore::OP_RESULT::OK) {
+         snapshot.seekedForPrev(*it, res, key);
+         return res;
+      }
+      while (res != leanstore::OP_RESULT::OK && partition > 0) {
+         enter(partition - 1);
+         res = seek_last();
+      }
+      return res;
+   }
+
+   template <typename RecordType>
+   static constexpr size_t type_index()
+   {
+      size_t i = 0, found = sizeof...(Records);
+      ((std::is_same_v<RecordType, Records> ? found = i++ : i++), ...);
+      return found;
+   }
+
+   void refresh_directory()
+   {
+      if (directory.bf == it->leaf.bf && directory.version == it->leaf.guard.version) {
+         return;
+      }
+      directory.bf = it->leaf.bf;
+      directory.version = it->leaf.guard.version;
+      const u16 count = it->leaf->count;
+      for (auto& next : directory.next_of_type) {
+         next.resize(count + 1);
+         next[count] = count;
+      }
+      for (s32 slot = count - 1; slot >= 0; slot--) {
+         const unsigned key_length = it->leaf->getFullKeyLen(slot);
+         for (size_t t = 0; t < key_lengths.size(); t++) {
+            directory.next_of_type[t][slot] = key_lengths[t] == key_length ? slot : directory.next_of_type[t][slot + 1];
+         }
+      }
+   }
+
+   std::optional<std::pair<std::variant<typename Records::Key...>, std::variant<Records...>>> read(BTreeIt& at)
+   {
+      std::optional<std::pair<std::variant<typename Records::Key...>, std::variant<Records...>>> kv;
+      snapshot.read(at, [&](leanstore::Slice key, leanstore::Slice payload) { kv = toType<Records...>(key, payload); });
+      return kv;
+   }
+};
@@ -1,7 +1,10 @@
 #pragma once
 
 #include <sys/types.h>
+#include <functional>
 #include <optional>
+#include "../scan_batch.hpp"
+#include "LeanStoreSnapshotCursor.hpp"
 #include "leanstore/KVInterface.hpp"
 #include "leanstore/storage/btree/core/BTreeGeneric.hpp"
 #include "leanstore/storage/btree/core/BTreeGenericIterator.hpp"
@@ -12,16 +15,30 @@ struct LeanStoreScanner {
    using BTree = leanstore::storage::btree::BTreeGeneric;
 
    std::unique_ptr<BTreeIt> it;
+   LeanStoreSnapshotCursor snapshot;
+   // Entries the iterator stepped onto after a seek, visible, filtered and invisible ones alike, counted the same
+   // by next(), next_batch() and for_each_view() in all scanners
    long long produced = 0;
    bool after_seek = false;
+   // Optional runtime filter (e.g. SemiJoinFilter::probe_predicate) evaluated on the entry in the page;
+   // next() and next_batch() skip entries it rejects before copying them
+   std::function<bool(const typename Record::Key&, const Record&)> filter;
 
-   LeanStoreScanner(BTree& btree) : it(std::make_unique<leanstore::storage::btree::BTreeSharedIterator>(btree)) { reset(); }
+   // vi: the same tree when it is versioned, so that entries are resolved against the active snapshot
+   LeanStoreScanner(BTree& btree, leanstore::storage::btree::BTreeVI* vi = nullptr)
+       : it(std::make_unique<leanstore::storage::btree::BTreeSharedIterator>(btree)), snapshot(vi)
+   {
+      reset();
+   }
 
    ~LeanStoreScanner() = default;
 
+   void set_filter(std::function<bool(const typename Record::Key&, const Record&)> f) { filter = std::move(f); }
+
    void reset()
    {
       it->reset();
+      snapshot.reset();
       this->produced = 0;
    }
 
@@ -35,7 +52,7 @@ struct LeanStoreScanner {
       u8 keyBuffer[RecordType::maxFoldLength()];
       unsigned pos = RecordType::foldKey(keyBuffer, k);
       leanstore::Slice keySlice(keyBuffer, pos);
-      [[maybe_unused]] const leanstore::OP_RESULT res = it->seek(keySlice);
+      const leanstore::OP_RESULT res = snapshot.seeked(*it, it->seek(keySlice), keySlice);
       if (res != leanstore::OP_RESULT::OK)
          return false;  // last key, next will return std::nullopt
       after_seek = true;
@@ -50,9 +67,10 @@ struct LeanStoreScanner {
       leanstore::Slice keySlice(keyBuffer, pos);
       const leanstore::OP_RESULT res = it->seekForPrev(keySlice);
       if (res != leanstore::OP_RESULT::OK) {
-         it->reset();  // next() will return first key
+         reset();  // next() will return first key
          return false;
       }
+      snapshot.seekedForPrev(*it, res, keySlice);
       after_seek = true;
       return true;
    }
@@ -63,7 +81,7 @@ struct LeanStoreScanner {
       u8 keyBuffer[JK::maxFoldLength()];
       unsigned pos = JK::keyfold(keyBuffer, jk);
       leanstore::Slice keySlice(keyBuffer, pos);
-      [[maybe_unused]] const leanstore::OP_RESULT res = it->seek(keySlice);
+      const leanstore::OP_RESULT res = snapshot.seeked(*it, it->seek(keySlice), keySlice);
       if (res != leanstore::OP_RESULT::OK)
          return false;  // last key, next will return std::nullopt
       after_seek = true;
@@ -72,43 +90,117 @@ struct LeanStoreScanner {
 
    std::optional<std::pair<typename Record::Key, Record>> next()
    {
-      this->produced++;
+      leanstore::OP_RESULT res = leanstore::OP_RESULT::OK;
       if (after_seek) {
          after_seek = false;
-         return this->current();
+      } else {
+         res = snapshot.next(*it);
+         this->produced++;
       }
-      leanstore::OP_RESULT res = it->next();
-      if (res != leanstore::OP_RESULT::OK)
-         return std::nullopt;
-      return this->current();
+      while (res == leanstore::OP_RESULT::OK) {
+         if (it->cur != -1 || snapshot.on_graveyard) {
+            auto kv = read(snapshot.at(*it), true);
+            if (kv) {
+               return kv;
+            }
+         }
+         res = snapshot.next(*it);  // not in the snapshot, or filtered
+         this->produced++;
+      }
+      return std::nullopt;
+   }
+
+   // Same positioning as repeated next() calls, the iterator stays on the last returned entry
+   template <size_t N>
+   size_t next_batch(ScanBatch<typename Record::Key, Record, N>& batch)
+   {
+      batch.clear();
+      while (!batch.full()) {
+         leanstore::OP_RESULT res = leanstore::OP_RESULT::OK;
+         if (after_seek) {
+            after_seek = false;
+         } else {
+            res = snapshot.next(*it);
+            this->produced++;
+         }
+         if (res != leanstore::OP_RESULT::OK) {
+            break;
+         }
+         if (it->cur == -1 && !snapshot.on_graveyard) {
+            continue;
+         }
+         snapshot.read(snapshot.at(*it), [&](leanstore::Slice key, leanstore::Slice payload) {
+            Record::unfoldKey(key.data(), batch.keys[batch.size]);
+            const Record& record = *reinterpret_cast<const Record*>(payload.data());
+            if (filter && !filter(batch.keys[batch.size], record)) {
+               return;
+            }
+            batch.records[batch.size] = record;
+            batch.size++;
+         });
+      }
+      return batch.size;
+   }
+
+   // Zero-copy scan from the same position as next(): calls cb(const Key&, const Record&) for the visible entries
+   // until it returns false. The record points into the leaf, which the shared iterator keeps latched until it
+   // moves to the next page, or into the visible version, so cb copies only what it keeps. The iterator stays
+   // on the entry cb stopped at, as after next(). Returns false once the scan is exhausted
+   template <typename CB>
+   bool for_each_view(CB&& cb)
+   {
+      leanstore::OP_RESULT res = leanstore::OP_RESULT::OK;
+      if (after_seek) {
+         after_seek = false;
+      } else {
+         res = snapshot.next(*it);
+         this->produced++;
+      }
+      for (; res == leanstore::OP_RESULT::OK; res = snapshot.next(*it), this->produced++) {
+         if (it->cur == -1 && !snapshot.on_graveyard) {
+            continue;
+         }
+         bool more = true;
+         snapshot.read(snapshot.at(*it), [&](leanstore::Slice key, leanstore::Slice payload) {
+            typename Record::Key typed_key;
+            Record::unfoldKey(key.data(), typed_key);
+            const Record& record = *reinterpret_cast<const Record*>(payload.data());
+            if (filter && !filter(typed_key, record)) {
+               return;
+            }
+            more = cb(typed_key, record);
+         });
+         if (!more) {
+            return true;
+         }
+      }
+      return false;
    }
 
    std::optional<std::pair<typename Record::Key, Record>> prev()
    {
+      leanstore::OP_RESULT res = leanstore::OP_RESULT::OK;
       if (after_seek) {
          after_seek = false;
-         return this->current();
+      } else {
+         res = snapshot.prev(*it);
       }
-      leanstore::OP_RESULT res = it->prev();
-      if (res != leanstore::OP_RESULT::OK)
-         return std::nullopt;
-      return this->current();
+      while (res == leanstore::OP_RESULT::OK) {
+         auto kv = this->current();
+         if (kv) {
+            return kv;
+         }
+         res = snapshot.prev(*it);  // not in the snapshot
+      }
+      return std::nullopt;
    }
 
    std::optional<std::pair<typename Record::Key, Record>> current()
    {
-      if (it->cur == -1) {
+      if (it->cur == -1 && !snapshot.on_graveyard) {
          return std::nullopt;
       }
-      it->assembleKey();
-      leanstore::Slice key = it->key();
-      leanstore::Slice payload = it->value();
-
-      Record typed_payload = *reinterpret_cast<const Record*>(payload.data());
-
-      typename Record::Key typed_key;
-      Record::unfoldKey(key.data(), typed_key);
-      return std::make_pair(typed_key, typed_payload);
+      return read(snapshot.at(*it));
    }
 
    std::optional<std::pair<typename Record::Key, Record>> last_in_page()
@@ -116,11 +208,27 @@ struct LeanStoreScanner {
       if (it->leaf->count > 0) {
          auto prev_cur = it->cur;
          it->cur = it->leaf->count - 1;
-         auto kv = current();
+         auto kv = read(*it);
          it->cur = prev_cur; // restore the cursor
          return kv;
       } else {
          return std::nullopt; // no records in the page
       }
    }
-};
\ No newline at end of file
+
+  private:
+   std::optional<std::pair<typename Record::Key, Record>> read(BTreeIt& at, bool filtered = false)
+   {
+      std::optional<std::pair<typename Record::Key, Record>> kv;
+      snapshot.read(at, [&](leanstore::Slice key, leanstore::Slice payload) {
+         typename Record::Key typed_key;
+         Record::unfoldKey(key.data(), typed_key);
+         const Record& record = *reinterpret_cast<const Record*>(payload.data());
+         if (filtered && filter && !filter(typed_key, record)) {
+            return;
+         }
+         kv.emplace(typed_key, record);
+      });
+      return kv;
+   }
+};
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <memory>
+#include "leanstore/Config.hpp"
+#include "leanstore/KVInterface.hpp"
+#include "leanstore/concurrency-recovery/Worker.hpp"
+#include "leanstore/storage/btree/BTreeVI.hpp"
+#include "leanstore/storage/btree/core/BTreeGenericIterator.hpp"
+
+// Visibility layer under the LeanStore scanners.
+// BTreeLL entries are handed out verbatim. BTreeVI entries are resolved against the active snapshot, and inside
+// OLAP transactions (--olap_mode --graveyard) the tuples that OLTP GC moved to the graveyard are merged back into
+// ascending scans, as BTreeVI::scanOLAP does for callback scans. Descending moves only see the main tree.
+struct LeanStoreSnapshotCursor {
+   using BTreeIt = leanstore::storage::btree::BTreeSharedIterator;
+   using BTreeVI = leanstore::storage::btree::BTreeVI;
+
+   BTreeVI* vi;
+   std::unique_ptr<BTreeIt> g_it;  // graveyard cursor, only positioned inside OLAP transactions
+   bool main_ok = false;
+   bool g_ok = false;
+   bool on_graveyard = false;  // the current entry comes from g_it
+   bool from_start = true;     // no seek since reset()
+
+   explicit LeanStoreSnapshotCursor(BTreeVI* vi) : vi(vi) {}
+
+   bool merges_graveyard() const
+   {
+      return vi != nullptr && FLAGS_olap_mode && FLAGS_graveyard && leanstore::cr::activeTX().isOLAP();
+   }
+
+   void reset()
+   {
+      main_ok = false;
+      g_ok = false;
+      on_graveyard = false;
+      from_start = true;
+      if (g_it)
+         g_it->reset();
+   }
+
+   // it has just been positioned by it.seek(key)
+   leanstore::OP_RESULT seeked(BTreeIt& it, leanstore::OP_RESULT res, leanstore::Slice key)
+   {
+      reset();
+      main_ok = res == leanstore::OP_RESULT::OK;
+      from_start = false;
+      return merges_graveyard() ? g_seek(it, key) : res;
+   }
+
+   // it has just been positioned by it.seekForPrev(key); the graveyard joins in from the main entry onwards
+   leanstore::OP_RESULT seekedForPrev(BTreeIt& it, leanstore::OP_RESULT res, leanstore::Slice key)
+   {
+      reset();
+      main_ok = res == leanstore::OP_RESULT::OK;
+      from_start = false;
+      if (!merges_graveyard())
+         return res;
+      if (main_ok) {
+         it.assembleKey();
+         key = it.key();
+      }
+      return g_seek(it, key);
+   }
+
+   leanstore::OP_RESULT next(BTreeIt& it)
+   {
+      if (from_start) {  // first step after reset(): the graveyard starts at the very beginning
+         const leanstore::OP_RESULT res = it.next();
+         main_ok = res == leanstore::OP_RESULT::OK;
+         return merges_graveyard() ? g_seek(it, leanstore::Slice()) : res;
+      }
+      if (on_graveyard) {
+         g_ok = g_it->next() == leanstore::OP_RESULT::OK;
+         return pick(it);
+      }
+      const leanstore::OP_RESULT res = it.next();
+      main_ok = res == leanstore::OP_RESULT::OK;
+      return g_ok ? pick(it) : res;
+   }
+
+   leanstore::OP_RESULT prev(BTreeIt& it)
+   {
+      from_start = false;
+      on_graveyard = false;
+      g_ok = false;
+      const leanstore::OP_RESULT res = it.prev();
+      main_ok = res == leanstore::OP_RESULT::OK;
+      return res;
+   }
+
+   // The iterator holding the current entry
+   BTreeIt& at(BTreeIt& it) { return on_graveyard ? *g_it : it; }
+
+   // Hands the version of the entry under at that the active transaction sees to cb(key, payload); false if there is none
+   template <typename CB>
+   bool read(BTreeIt& at, CB&& cb)
+   {
+      at.assembleKey();
+      leanstore::Slice key = at.key();
+      if (vi == nullptr) {
+         cb(key, at.value());
+         return true;
+      }
+      bool found = false;
+      vi->readVisible(key, at.value(), [&](leanstore::Slice payload) {
+         found = true;
+         cb(key, payload);
+      });
+      return found;
+   }
+
+  private:
+   leanstore::OP_RESULT g_seek(BTreeIt& it, leanstore::Slice key)
+   {
+      from_start = false;
+      if (!g_it)
+         g_it = std::make_unique<BTreeIt>(*static_cast<leanstore::storage::btree::BTreeGeneric*>(vi->graveyard));
+      g_it->reset();
+      g_ok = g_it->seek(key) == leanstore::OP_RESULT::OK;
+      return pick(it);
+   }
+
+   leanstore::OP_RESULT pick(BTreeIt& it)
+   {
+      if (g_ok && main_ok) {
+         it.assembleKey();
+         g_it->assembleKey();
+         on_graveyard = g_it->key() < it.key();
+      } else {
+         on_graveyard = g_ok;
+      }
+      return (main_ok || g_ok) ? leanstore::OP_RESULT::OK : leanstore::OP_RESULT::NOT_FOUND;
+   }
+};
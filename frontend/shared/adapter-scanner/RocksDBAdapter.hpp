@@ -82,6 +82,37 @@ struct RocksDBAdapter : public Adapter<Record> {
       assert(it->status().ok());
       delete it;
    }
+   // Like LeanStoreAdapter::scanFiltered, on the key and value of the iterator
+   template <typename PastEnd, typename Keep, typename CB>
+   void scanFiltered(const typename Record::Key& key, PastEnd&& past_end, Keep&& keep, CB&& cb)
+   {
+      std::string key_buf;
+      rocksdb::Slice folded_key = map.template fold_key<Record>(key, key_buf, true);
+      rocksdb::Iterator* it = map.tx_db->NewIterator(map.iterator_ro, cf_handle);
+      for (it->Seek(folded_key); it->Valid(); it->Next()) {
+         u8 id;
+         const u8* key_data = reinterpret_cast<const u8*>(it->key().data());
+         unsigned pos = unfold(key_data, id);
+         if (id != static_cast<u8>(Record::id)) {  // passed the record type
+            assert(id > static_cast<u8>(Record::id));
+            break;
+         }
+         const u16 key_length = it->key().size() - pos;
+         const u8* payload = reinterpret_cast<const u8*>(it->value().data());
+         if (past_end(key_data + pos, key_length)) {
+            break;
+         }
+         if (!keep(key_data + pos, key_length, payload)) {
+            continue;
+         }
+         typename Record::Key s_key;
+         Record::unfoldKey(key_data + pos, s_key);
+         if (!cb(s_key, *reinterpret_cast<const Record*>(payload)))
+            break;
+      }
+      assert(it->status().ok());
+      delete it;
+   }
    // Not part of a txn
    void scanDesc(const typename Record::Key& key,
                  const std::function<bool(const typename Record::Key&, const Record&)>& fn,
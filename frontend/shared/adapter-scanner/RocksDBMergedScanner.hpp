@@ -1,7 +1,9 @@
 #pragma once
 
+#include <cstring>
 #include "Exceptions.hpp"
 #include "../RocksDB.hpp"
+#include "../scan_batch.hpp"
 #include "../variant_utils.hpp"
 
 template <typename JK, typename JR, typename... Records>
@@ -9,7 +11,7 @@ struct RocksDBMergedScanner {
    RocksDB& map;
    std::unique_ptr<rocksdb::Iterator> it;
    bool after_seek = false;
-   long long produced = 0;
+   long long produced = 0;  // see LeanStoreScanner::produced
 
    RocksDBMergedScanner(ColumnFamilyHandle* cf_handle, RocksDB& map) : map(map), it(map.tx_db->NewIterator(map.iterator_ro, cf_handle))
    {
@@ -89,6 +91,48 @@ struct RocksDBMergedScanner {
       return current();
    }
 
+   // Same positioning as repeated next() calls, the iterator stays on the last returned entry
+   template <size_t N>
+   size_t next_batch(ScanBatch<std::variant<typename Records::Key...>, std::variant<Records...>, N>& batch)
+   {
+      batch.clear();
+      while (!batch.full()) {
+         if (after_seek) {
+            after_seek = false;
+         } else {
+            if (!it->Valid()) {
+               break;
+            }
+            it->Next();
+            produced++;
+         }
+         if (!it->Valid()) {
+            break;
+         }
+         assignType<Records...>(it->key(), it->value(), batch.keys[batch.size], batch.records[batch.size]);
+         batch.size++;
+      }
+      return batch.size;
+   }
+
+   // Zero-copy scan, see LeanStoreMergedScanner::for_each_view
+   template <typename CB>
+   bool for_each_view(CB&& cb)
+   {
+      if (after_seek) {
+         after_seek = false;
+      } else if (it->Valid()) {
+         it->Next();
+         produced++;
+      }
+      for (; it->Valid(); it->Next(), produced++) {
+         if (!visitType<Records...>(it->key(), it->value(), cb)) {
+            return true;
+         }
+      }
+      return false;
+   }
+
    std::optional<std::pair<std::variant<typename Records::Key...>, std::variant<Records...>>> prev()
    {
       if (after_seek) {
@@ -114,6 +158,32 @@ struct RocksDBMergedScanner {
       return std::make_pair(key, rec);
    }
 
+   // See LeanStoreMergedScanner::advance
+   bool advance()
+   {
+      if (!after_seek) {
+         if (!it->Valid()) {
+            return false;
+         }
+         it->Next();
+         produced++;
+         after_seek = true;
+      }
+      return it->Valid();
+   }
+
+   unsigned folded_key(u8* out)
+   {
+      if (!it->Valid()) {
+         return 0;
+      }
+      const rocksdb::Slice key = it->key();
+      std::memcpy(out, key.data(), key.size());
+      return key.size();
+   }
+
+   void consume() { after_seek = false; }
+
    std::optional<std::pair<std::variant<typename Records::Key...>, std::variant<Records...>>> last_in_page()
    {
       return std::nullopt; // a page/block is not necessarily continuous
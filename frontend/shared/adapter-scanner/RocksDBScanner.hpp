@@ -2,7 +2,9 @@
 
 #include <rocksdb/iterator.h>
 #include <rocksdb/slice.h>
+#include <functional>
 #include "../RocksDB.hpp"
+#include "../scan_batch.hpp"
 #include "Units.hpp"
 
 using ROCKSDB_NAMESPACE::ColumnFamilyHandle;
@@ -15,11 +17,15 @@ class RocksDBScanner
 
   public:
    bool after_seek = false;
-   long long produced = 0;
+   long long produced = 0;  // see LeanStoreScanner::produced
+   // Optional runtime filter, next() and next_batch() skip entries it rejects before copying them
+   std::function<bool(const typename Record::Key&, const Record&)> filter;
 
    RocksDBScanner(ColumnFamilyHandle* cf_handle, RocksDB& map) : map(map), it(map.tx_db->NewIterator(map.iterator_ro, cf_handle)) { seek_to_first(); }
    ~RocksDBScanner() = default;
 
+   void set_filter(std::function<bool(const typename Record::Key&, const Record&)> f) { filter = std::move(f); }
+
    void seek_to_first()
    {
       std::string key_buf(1, 0);
@@ -95,9 +101,79 @@ class RocksDBScanner
          it->Next();
          produced++;
       }
+      while (filter && it->Valid() && rejected()) {
+         it->Next();
+         produced++;
+      }
       return current();
    }
 
+   // Same positioning as repeated next() calls, the iterator stays on the last returned entry
+   template <size_t N>
+   size_t next_batch(ScanBatch<typename Record::Key, Record, N>& batch)
+   {
+      batch.clear();
+      while (!batch.full()) {
+         if (after_seek) {
+            after_seek = false;
+         } else {
+            if (!it->Valid()) {
+               break;
+            }
+            it->Next();
+            produced++;
+         }
+         if (!it->Valid()) {
+            break;
+         }
+         u8 id;
+         const u8* key_data = reinterpret_cast<const u8*>(it->key().data());
+         unsigned pos = unfold(key_data, id);
+         if (id != static_cast<u8>(Record::id)) {  // passed the record type
+            break;
+         }
+         Record::unfoldKey(key_data + pos, batch.keys[batch.size]);
+         const Record& record = *reinterpret_cast<const Record*>(it->value().data());
+         if (filter && !filter(batch.keys[batch.size], record)) {
+            continue;
+         }
+         batch.records[batch.size] = record;
+         batch.size++;
+      }
+      return batch.size;
+   }
+
+   // Zero-copy scan from the same position as next(): calls cb(const Key&, const Record&) with the record in the
+   // iterator's block until it returns false, see LeanStoreScanner::for_each_view. Returns false once the scan is exhausted
+   template <typename CB>
+   bool for_each_view(CB&& cb)
+   {
+      if (after_seek) {
+         after_seek = false;
+      } else if (it->Valid()) {
+         it->Next();
+         produced++;
+      }
+      for (; it->Valid(); it->Next(), produced++) {
+         u8 id;
+         const u8* key_data = reinterpret_cast<const u8*>(it->key().data());
+         unsigned pos = unfold(key_data, id);
+         if (id != static_cast<u8>(Record::id)) {  // passed the record type
+            return false;
+         }
+         typename Record::Key key;
+         Record::unfoldKey(key_data + pos, key);
+         const Record& record = *reinterpret_cast<const Record*>(it->value().data());
+         if (filter && !filter(key, record)) {
+            continue;
+         }
+         if (!cb(key, record)) {
+            return true;
+         }
+      }
+      return false;
+   }
+
    std::optional<std::pair<typename Record::Key, Record>> prev()
    {
       if (after_seek) {
@@ -113,4 +189,19 @@ class RocksDBScanner
       }
       return current();
    }
-};
\ No newline at end of file
+
+  private:
+   // Whether the filter drops the current entry; entries of other record types are left to current()
+   bool rejected()
+   {
+      u8 id;
+      const u8* key_data = reinterpret_cast<const u8*>(it->key().data());
+      unsigned pos = unfold(key_data, id);
+      if (id != static_cast<u8>(Record::id)) {
+         return false;
+      }
+      typename Record::Key key;
+      Record::unfoldKey(key_data + pos, key);
+      return !filter(key, *reinterpret_cast<const Record*>(it->value().data()));
+   }
+};
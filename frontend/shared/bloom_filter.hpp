@@ -0,0 +1,99 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <functional>
+#include <vector>
+#include "Units.hpp"
+#include "flat_hash_multimap.hpp"
+#include "view_templates.hpp"
+
+// Blocked Bloom filter: all bits of a key fall into one 64-byte block, so a lookup costs a single cache miss.
+// About bits_per_key bits per expected key; a little less precise than a classic Bloom filter of that size.
+class BlockedBloomFilter
+{
+  public:
+   static constexpr unsigned BITS_PER_INSERT = 6;
+
+   explicit BlockedBloomFilter(size_t expected_keys, size_t bits_per_key = 10)
+       : blocks(std::bit_ceil(std::max<size_t>(1, expected_keys * bits_per_key / BLOCK_BITS + 1))), mask(blocks.size() - 1)
+   {
+   }
+
+   void insert(u64 hash)
+   {
+      Block& block = blocks[block_of(hash)];
+      for_each_bit(hash, [&](unsigned bit) { block[bit / 64] |= u64(1) << (bit % 64); });
+   }
+
+   bool may_contain(u64 hash) const
+   {
+      const Block& block = blocks[block_of(hash)];
+      bool contained = true;
+      for_each_bit(hash, [&](unsigned bit) { contained &= (block[bit / 64] >> (bit % 64)) & 1; });
+      return contained;
+   }
+
+   size_t bytes() const { return blocks.size() * sizeof(Block); }
+
+  private:
+   static constexpr unsigned BLOCK_BITS = 512;
+   using Block = std::array<u64, BLOCK_BITS / 64>;
+
+   std::vector<Block> blocks;
+   const size_t mask;
+
+   size_t block_of(u64 hash) const { return (hash >> 32) & mask; }
+
+   // Double hashing within the block on the low 32 bits
+   template <typename F>
+   static void for_each_bit(u64 hash, F&& f)
+   {
+      const u32 h1 = static_cast<u32>(hash);
+      const u32 h2 = (h1 >> 16) | 1;
+      for (unsigned i = 0; i < BITS_PER_INSERT; i++) {
+         f((h1 + i * h2) % BLOCK_BITS);
+      }
+   }
+};
+
+// Runtime filter for semi-join reduction: filled with the JKs of the smaller (build) input, then pushed into
+// the scanners of a larger input, which drop entries whose JK at the build input's level cannot match
+template <typename JK>
+class SemiJoinFilter
+{
+  public:
+   explicit SemiJoinFilter(size_t expected_keys) : filter(expected_keys) {}
+
+   void insert(const JK& jk)
+   {
+      filter.insert(hash_of(jk));
+      inserted++;
+   }
+
+   bool may_contain(const JK& jk) const { return filter.may_contain(hash_of(jk)); }
+
+   // Predicate for scanners of ProbeRecord: keeps the entries whose JK truncated to BuildRecord's level may be
+   // in the filter. Entries outside range are kept, so that the consumer still sees where its range ends
+   // instead of the scanner skipping to the end of the table. The filter must outlive the scanner
+   template <typename BuildRecord, typename ProbeRecord>
+   std::function<bool(const typename ProbeRecord::Key&, const ProbeRecord&)> probe_predicate(const JK& range = JK::max()) const
+   {
+      return [this, range](const typename ProbeRecord::Key& k, const ProbeRecord& v) {
+         const JK jk = SKBuilder<JK>::create(k, v);
+         if (range != JK::max() && jk.match(range) != 0) {
+            return true;
+         }
+         return may_contain(SKBuilder<JK>::template get<BuildRecord>(jk));
+      };
+   }
+
+   size_t size() const { return inserted; }
+   size_t bytes() const { return filter.bytes(); }
+
+  private:
+   BlockedBloomFilter filter;
+   size_t inserted = 0;
+
+   static u64 hash_of(const JK& jk) { return flat_hash_mix(std::hash<JK>()(jk)); }
+};
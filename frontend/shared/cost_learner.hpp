@@ -0,0 +1,16 @@
+#pragma once
+#include <cstddef>
+
+// Learning rules shared by the cost-based choices (AccessPathRouter, PremergedCostModel): a cost estimate is the moving
+// average of its observations, and every EXPLORE_EVERY decisions a choice other than the expected cheapest one is tried
+// once, so that the estimates of all alternatives follow the data and the buffer pool.
+struct CostLearner {
+   static constexpr double ALPHA = 0.25;        // weight of a new observation
+   static constexpr size_t EXPLORE_EVERY = 32;  // decisions after which an alternative is tried once
+
+   // average is 0 while nothing was observed
+   static double update(double average, double observed) { return average == 0 ? observed : (1 - ALPHA) * average + ALPHA * observed; }
+
+   // Counts a decision, true if it is to explore
+   static bool explore(size_t& decisions) { return ++decisions % EXPLORE_EVERY == 0; }
+};
@@ -0,0 +1,123 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <vector>
+#include "Units.hpp"
+
+// Changes buffered for one maintenance epoch and applied in the order of the B-tree, so that consecutive changes
+// descend into the same leaves instead of random ones.
+
+// A key of Record in its folded form, ordered like the trees order it
+template <typename Record>
+struct FoldedKeyOf {
+   std::array<u8, Record::maxFoldLength()> bytes;
+   unsigned length;
+
+   explicit FoldedKeyOf(const typename Record::Key& key) : length(Record::foldKey(bytes.data(), key)) {}
+
+   friend bool operator<(const FoldedKeyOf& a, const FoldedKeyOf& b)
+   {
+      const int cmp = std::memcmp(a.bytes.data(), b.bytes.data(), std::min(a.length, b.length));
+      return cmp < 0 || (cmp == 0 && a.length < b.length);
+   }
+   friend bool operator==(const FoldedKeyOf& a, const FoldedKeyOf& b)
+   {
+      return a.length == b.length && std::memcmp(a.bytes.data(), b.bytes.data(), a.length) == 0;
+   }
+};
+
+// Inserts and erases of Record
+template <typename Record>
+class DeltaBatch
+{
+  public:
+   struct Change {
+      FoldedKeyOf<Record> folded;
+      typename Record::Key key;
+      Record record;  // unset for erases
+      bool erase;
+   };
+
+   void insert(const typename Record::Key& key, const Record& record)
+   {
+      changes.push_back(Change{FoldedKeyOf<Record>(key), key, record, false});
+      count = changes.size();
+   }
+   void erase(const typename Record::Key& key)
+   {
+      changes.push_back(Change{FoldedKeyOf<Record>(key), key, Record{}, true});
+      count = changes.size();
+   }
+
+   // The only member that other threads than the one maintaining the batch may read
+   size_t size() const { return count; }
+   bool empty() const { return count == 0; }
+   void clear()
+   {
+      changes.clear();
+      count = 0;
+   }
+
+   // The changes in key order; those to one key keep their order, and an insert erased again in the same epoch is
+   // dropped with its erase
+   const std::vector<Change>& sorted()
+   {
+      std::stable_sort(changes.begin(), changes.end(), [](const Change& a, const Change& b) { return a.folded < b.folded; });
+      std::vector<Change> coalesced;
+      coalesced.reserve(changes.size());
+      for (Change& c : changes) {
+         if (c.erase && !coalesced.empty() && !coalesced.back().erase && coalesced.back().folded == c.folded) {
+            coalesced.pop_back();
+            continue;
+         }
+         coalesced.push_back(std::move(c));
+      }
+      changes.swap(coalesced);
+      count = changes.size();
+      return changes;
+   }
+
+  private:
+   std::vector<Change> changes;
+   std::atomic<size_t> count = 0;
+};
+
+// Additive deltas of an aggregate per group, e.g. the customer count of a city, coalesced so that every group is
+// read and written once per epoch
+template <typename Record>
+class CounterDeltas
+{
+  public:
+   void add(const typename Record::Key& key, long delta) { deltas.push_back(Delta{FoldedKeyOf<Record>(key), key, delta}); }
+
+   bool empty() const { return deltas.empty(); }
+   void clear() { deltas.clear(); }
+
+   // Calls f(key, delta) once per group with a non-zero sum, in key order
+   template <typename F>
+   void for_each_sorted(F&& f)
+   {
+      std::stable_sort(deltas.begin(), deltas.end(), [](const Delta& a, const Delta& b) { return a.folded < b.folded; });
+      for (size_t i = 0; i < deltas.size();) {
+         long sum = 0;
+         size_t j = i;
+         for (; j < deltas.size() && deltas[j].folded == deltas[i].folded; j++) {
+            sum += deltas[j].delta;
+         }
+         if (sum != 0) {
+            f(deltas[i].key, sum);
+         }
+         i = j;
+      }
+   }
+
+  private:
+   struct Delta {
+      FoldedKeyOf<Record> folded;
+      typename Record::Key key;
+      long delta;
+   };
+   std::vector<Delta> deltas;
+};
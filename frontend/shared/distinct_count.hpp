@@ -0,0 +1,205 @@
+#pragma once
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "Types.hpp"
+#include "Units.hpp"
+#include "flat_hash_multimap.hpp"
+
+// COUNT(DISTINCT) over short string columns such as c_mktsegment: the strings are mapped to small IDs by a
+// dictionary that lives for the whole query, a group then only keeps a bitset over the IDs.
+
+// Length and bytes of a short Varchar, zero padded to one SSE register
+struct alignas(16) PackedString {
+   u8 bytes[16];
+
+   template <int maxLength>
+   static PackedString pack(const Varchar<maxLength>& s)
+   {
+      static_assert(sizeof(s.length) + maxLength <= sizeof(bytes), "only short strings fit into a register");
+      PackedString p{};
+      memcpy(p.bytes, &s.length, sizeof(s.length));
+      memcpy(p.bytes + sizeof(s.length), s.data, s.length);
+      return p;
+   }
+
+   bool operator==(const PackedString& other) const { return memcmp(bytes, other.bytes, sizeof(bytes)) == 0; }
+
+   u64 hash() const
+   {
+      u64 lo, hi;
+      memcpy(&lo, bytes, sizeof(lo));
+      memcpy(&hi, bytes + sizeof(lo), sizeof(hi));
+      return flat_hash_mix(lo ^ std::rotl(hi, 29));
+   }
+};
+
+// Dense IDs in insertion order. The first SIMD_ENTRIES strings are found by comparing whole registers,
+// which covers the usual low-cardinality columns; larger dictionaries fall back to a hash index.
+class ShortStringDictionary
+{
+  public:
+   static constexpr size_t SIMD_ENTRIES = 16;
+
+   u32 id_of(const PackedString& p)
+   {
+      const size_t tiny = std::min(entries.size(), SIMD_ENTRIES);
+#if defined(__SSE2__)
+      const __m128i key = _mm_load_si128(reinterpret_cast<const __m128i*>(p.bytes));
+      for (size_t i = 0; i < tiny; i++) {
+         const __m128i entry = _mm_load_si128(reinterpret_cast<const __m128i*>(entries[i].bytes));
+         if (_mm_movemask_epi8(_mm_cmpeq_epi8(key, entry)) == 0xFFFF) {
+            return i;
+         }
+      }
+#else
+      for (size_t i = 0; i < tiny; i++) {
+         if (entries[i] == p) {
+            return i;
+         }
+      }
+#endif
+      if (entries.size() > SIMD_ENTRIES) {
+         auto it = index.find(p);
+         if (it != index.end()) {
+            return it->second;
+         }
+      }
+      const u32 id = entries.size();
+      entries.push_back(p);
+      if (id >= SIMD_ENTRIES) {
+         index.emplace(p, id);
+      }
+      return id;
+   }
+
+   size_t size() const { return entries.size(); }
+
+  private:
+   struct Hash {
+      size_t operator()(const PackedString& p) const { return p.hash(); }
+   };
+
+   std::vector<PackedString> entries;
+   std::unordered_map<PackedString, u32, Hash> index;
+};
+
+// HyperLogLog with 2^P one-byte registers (about 3% standard error for P = 10). The harmonic sum and the
+// number of empty registers are maintained on insert, so estimate() is O(1).
+class HyperLogLog
+{
+  public:
+   static constexpr unsigned P = 10;
+   static constexpr size_t REGISTERS = size_t(1) << P;
+
+   void insert(u64 hash)
+   {
+      u8& reg = registers[hash >> (64 - P)];
+      const u8 rank = std::countl_zero((hash << P) | (u64(1) << (P - 1))) + 1;
+      if (rank > reg) {
+         inverse_sum += std::ldexp(1.0, -rank) - std::ldexp(1.0, -reg);
+         zeros -= reg == 0;
+         reg = rank;
+      }
+   }
+
+   double estimate() const
+   {
+      constexpr double alpha = 0.7213 / (1 + 1.079 / REGISTERS);
+      const double raw = alpha * REGISTERS * REGISTERS / inverse_sum;
+      if (raw <= 2.5 * REGISTERS && zeros > 0) {
+         return REGISTERS * std::log(static_cast<double>(REGISTERS) / zeros);  // linear counting for small sets
+      }
+      return raw;
+   }
+
+   void clear()
+   {
+      registers.fill(0);
+      inverse_sum = REGISTERS;
+      zeros = REGISTERS;
+   }
+
+  private:
+   std::array<u8, REGISTERS> registers{};
+   double inverse_sum = REGISTERS;
+   size_t zeros = REGISTERS;
+};
+
+namespace agg
+{
+// Drop-in for DistinctCount over short Varchars. Copies share the dictionary, so IDs agree across the groups
+// of a query. With approximate, every group is counted by a HyperLogLog instead, for groups too large to
+// keep exactly.
+template <typename Get>
+struct ShortStringDistinctCount {
+   Get get;
+   std::shared_ptr<ShortStringDictionary> dictionary = std::make_shared<ShortStringDictionary>();
+   std::vector<u64> members;  // bitset over the dictionary IDs
+   std::vector<u32> touched;  // words of members that are set
+   std::unique_ptr<HyperLogLog> hll;
+   long value = 0;
+
+   explicit ShortStringDistinctCount(Get get = Get(), bool approximate = false) : get(std::move(get))
+   {
+      if (approximate) {
+         hll = std::make_unique<HyperLogLog>();
+      }
+   }
+
+   ShortStringDistinctCount(const ShortStringDistinctCount& other)
+       : get(other.get),
+         dictionary(other.dictionary),
+         members(other.members),
+         touched(other.touched),
+         hll(other.hll ? std::make_unique<HyperLogLog>(*other.hll) : nullptr),
+         value(other.value)
+   {
+   }
+   ShortStringDistinctCount(ShortStringDistinctCount&&) = default;
+   ShortStringDistinctCount& operator=(ShortStringDistinctCount&&) = default;
+
+   template <typename K, typename V>
+   void add(const K& k, const V& v)
+   {
+      const PackedString p = PackedString::pack(get(k, v));
+      if (hll) {
+         hll->insert(p.hash());
+         value = std::lround(hll->estimate());
+         return;
+      }
+      const u32 id = dictionary->id_of(p);
+      const u32 word = id / 64;
+      if (word >= members.size()) {
+         members.resize(word + 1, 0);
+      }
+      const u64 bit = u64(1) << (id % 64);
+      if ((members[word] & bit) == 0) {
+         if (members[word] == 0) {
+            touched.push_back(word);
+         }
+         members[word] |= bit;
+         value++;
+      }
+   }
+
+   void reset()
+   {
+      if (hll) {
+         hll->clear();
+      }
+      for (u32 word : touched) {
+         members[word] = 0;
+      }
+      touched.clear();
+      value = 0;
+   }
+};
+}  // namespace agg
@@ -0,0 +1,143 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <functional>
+#include <vector>
+#include "Units.hpp"
+
+// murmur3 finalizer, the std::hash of integer keys is the identity
+inline u64 flat_hash_mix(u64 h)
+{
+   h ^= h >> 33;
+   h *= 0xff51afd7ed558ccdULL;
+   h ^= h >> 33;
+   h *= 0xc4ceb9fe1a85ec53ULL;
+   h ^= h >> 33;
+   return h;
+}
+
+// Open-addressing multimap for hash join build sides. Entries live contiguously in insertion order and
+// are never moved by a rehash; the bucket array holds a 7-bit tag (0 = empty) and the index of the
+// newest entry per distinct key, entries with the same key are chained through Entry::next.
+// Linear probing with a load factor of at most 1/2 on distinct keys.
+template <typename K, typename V, typename Hash = std::hash<K>>
+class FlatHashMultimap
+{
+  public:
+   struct Entry {
+      K key;
+      V value;
+      u32 next;
+   };
+
+   explicit FlatHashMultimap(size_t expected_size = 0) { reserve(expected_size); }
+
+   void reserve(size_t expected_size)
+   {
+      entries.reserve(expected_size);
+      const size_t buckets = std::bit_ceil(std::max(MIN_BUCKETS, expected_size * 2));
+      if (buckets > tags.size()) {
+         rehash(buckets);
+      }
+   }
+
+   void emplace(const K& key, const V& value)
+   {
+      if ((distinct + 1) * 2 > tags.size()) {
+         rehash(tags.size() * 2);
+      }
+      const u64 h = hash_of(key);
+      const u8 tag = tag_of(h);
+      const u32 index = entries.size();
+      for (size_t slot = h & mask;; slot = (slot + 1) & mask) {
+         if (tags[slot] == EMPTY) {
+            tags[slot] = tag;
+            heads[slot] = index;
+            entries.push_back(Entry{key, value, NONE});
+            distinct++;
+            return;
+         }
+         if (tags[slot] == tag && entries[heads[slot]].key == key) {
+            entries.push_back(Entry{key, value, heads[slot]});
+            heads[slot] = index;
+            return;
+         }
+      }
+   }
+
+   // Calls f(const V&) for every value stored under key
+   template <typename F>
+   void for_each_equal(const K& key, F&& f) const
+   {
+      const u64 h = hash_of(key);
+      const u8 tag = tag_of(h);
+      for (size_t slot = h & mask; tags[slot] != EMPTY; slot = (slot + 1) & mask) {
+         if (tags[slot] == tag && entries[heads[slot]].key == key) {
+            for (u32 i = heads[slot]; i != NONE; i = entries[i].next) {
+               f(entries[i].value);
+            }
+            return;
+         }
+      }
+   }
+
+   // Issue the bucket loads of a future lookup
+   void prefetch(const K& key) const
+   {
+      const size_t slot = hash_of(key) & mask;
+      __builtin_prefetch(&tags[slot]);
+      __builtin_prefetch(&heads[slot]);
+   }
+
+   // Calls f(const K&) once per distinct key
+   template <typename F>
+   void for_each_key(F&& f) const
+   {
+      for (size_t slot = 0; slot < tags.size(); slot++) {
+         if (tags[slot] != EMPTY) {
+            f(entries[heads[slot]].key);
+         }
+      }
+   }
+
+   size_t size() const { return entries.size(); }
+   size_t distinct_keys() const { return distinct; }
+
+   size_t bytes() const { return entries.capacity() * sizeof(Entry) + tags.capacity() * sizeof(u8) + heads.capacity() * sizeof(u32); }
+
+  private:
+   static constexpr u8 EMPTY = 0;
+   static constexpr u32 NONE = ~u32(0);
+   static constexpr size_t MIN_BUCKETS = 16;
+
+   std::vector<Entry> entries;
+   std::vector<u8> tags;
+   std::vector<u32> heads;
+   size_t distinct = 0;
+   size_t mask = 0;
+
+   static u64 hash_of(const K& key) { return flat_hash_mix(Hash()(key)); }
+
+   static u8 tag_of(u64 h) { return 0x80 | static_cast<u8>(h >> 57); }
+
+   void rehash(size_t buckets)
+   {
+      std::vector<u8> old_tags(buckets, EMPTY);
+      std::vector<u32> old_heads(buckets);
+      std::swap(tags, old_tags);
+      std::swap(heads, old_heads);
+      mask = buckets - 1;
+      for (size_t old_slot = 0; old_slot < old_tags.size(); old_slot++) {
+         if (old_tags[old_slot] == EMPTY) {
+            continue;
+         }
+         size_t slot = hash_of(entries[old_heads[old_slot]].key) & mask;
+         while (tags[slot] != EMPTY) {
+            slot = (slot + 1) & mask;
+         }
+         tags[slot] = old_tags[old_slot];
+         heads[slot] = old_heads[old_slot];
+      }
+   }
+};
@@ -0,0 +1,190 @@
+#pragma once
+#include <array>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+#include "variant_tuple_utils.hpp"
+
+// Declarative description of a hierarchical join path such as nation -> states -> county -> city -> customer2
+// or order -> lineitem. The JK lists one field per level from the root down; level i is keyed by the first i + 1
+// fields and its records leave the deeper fields 0. The merge joins, PremergedJoin and the merged adapters only
+// rely on the JK operations below, so a new hierarchy needs its records, a JK built on hierarchical_key and a
+// JoinPath specialization of join_path_of.
+
+// JK operations derived from the fields of a hierarchy, root first. A field of 0 is a wildcard.
+template <typename JK, auto JK::*... Fields>
+struct hierarchical_key {
+   static constexpr size_t depth = sizeof...(Fields);
+   using Field = std::common_type_t<std::remove_cvref_t<decltype(std::declval<JK>().*Fields)>...>;
+
+   static std::array<Field, depth> values(const JK& k) { return {k.*Fields...}; }
+
+   // Folded length of the first i fields, as key_traits::keyfold lays them out
+   static constexpr std::array<unsigned, depth + 1> prefix_lengths = []() {
+      const std::array<unsigned, depth> sizes{sizeof(std::declval<JK>().*Fields)...};
+      std::array<unsigned, depth + 1> lengths{};
+      for (size_t i = 0; i < depth; i++) {
+         lengths[i + 1] = lengths[i] + sizes[i];
+      }
+      return lengths;
+   }();
+
+   static JK max()
+   {
+      JK k{};
+      ((k.*Fields = std::numeric_limits<Field>::max()), ...);
+      return k;
+   }
+
+   // Keeps the first `fields` fields, e.g. the JK of the record at level fields - 1
+   static JK prefix(const JK& k, size_t fields)
+   {
+      JK p = k;
+      size_t i = 0;
+      ((i++ >= fields ? (p.*Fields = 0, 0) : 0), ...);
+      return p;
+   }
+
+   // Difference at the first field set on both sides, 0 if one key is a prefix of the other
+   static int match(const JK& a, const JK& b)
+   {
+      // the all-zero key cannot be used as wildcard
+      const JK zero{};
+      if (a == zero && b == zero)
+         return 0;
+      else if (a == zero)
+         return -1;
+      else if (b == zero)
+         return 1;
+      int diff = 0;
+      ((a.*Fields != 0 && b.*Fields != 0 && a.*Fields != b.*Fields && (diff = a.*Fields - b.*Fields, true)) || ...);
+      return diff;
+   }
+
+   // (field, base value, distance) of the first field where k differs from base, (depth, 0, 0) if none
+   static std::tuple<int, int, int> first_diff(const JK& k, const JK& base)
+   {
+      std::tuple<int, int, int> diff{static_cast<int>(depth), 0, 0};
+      int field = 0;
+      ((k.*Fields != base.*Fields ? (diff = std::make_tuple(field, base.*Fields, k.*Fields - base.*Fields), true) : (field++, false)) || ...);
+      return diff;
+   }
+
+   // The keys of the ancestors that k joins with, deepest first, then k itself
+   static std::vector<JK> matching_keys(const JK& k)
+   {
+      const auto v = values(k);
+      std::vector<JK> result;
+      for (size_t i = depth - 1; i > 0; i--) {
+         if (v[i] != 0) {
+            result.push_back(prefix(k, i));
+         }
+      }
+      result.push_back(k);
+      return result;
+   }
+
+   // Number of leading fields that k sets, i.e. the level a selection asks for
+   static size_t selected_depth(const JK& k)
+   {
+      size_t n = 0;
+      bool set = true;
+      ((set = set && k.*Fields != 0, n += set), ...);
+      return n;
+   }
+
+   // Fills the fields of a selection with those of the first key found for it, keeping its wildcards
+   static void fill_selected(JK& selection, const JK& found) { ((selection.*Fields = selection.*Fields != 0 ? found.*Fields : 0), ...); }
+};
+
+// A JK in the order-preserving folded form of key_traits::keyfold. When the records of a merged index are keyed by
+// JK prefixes (nation2_t by nationkey, states_t by nationkey and statekey, ...), a scanned key is compared with it by
+// memcmp on the stored bytes, without decoding the entry.
+template <typename JK>
+struct FoldedJK {
+   uint8_t bytes[JK::maxFoldLength()];
+   unsigned length = 0;  // of the fields before the first wildcard
+   bool exact = true;    // compare() agrees with JK::match(): some field is set and none after a wildcard
+
+   explicit FoldedJK(const JK& jk)
+   {
+      JK::keyfold(bytes, jk);
+      const auto fields = JK::hierarchy::values(jk);
+      size_t set = 0;
+      while (set < fields.size() && fields[set] != 0) {
+         set++;
+      }
+      length = JK::hierarchy::prefix_lengths[set];
+      exact = set > 0 && std::all_of(fields.begin() + set, fields.end(), [](const auto& f) { return f == 0; });
+   }
+
+   // Sign of match() between the JK of an entry with the folded key `key` and this
+   int compare(const uint8_t* key, unsigned key_length) const { return std::memcmp(key, bytes, std::min(key_length, length)); }
+};
+
+// The record types of a join path, one per JK field
+template <typename Key, typename... Levels>
+struct JoinPath {
+   using JK = Key;
+   static constexpr size_t depth = sizeof...(Levels);
+   static_assert(depth == JK::hierarchy::depth, "one level per JK field");
+
+   template <size_t I>
+   using Level = std::tuple_element_t<I, std::tuple<Levels...>>;
+
+   template <typename R>
+   static constexpr size_t level_of = index_of_type<R, Levels...>();
+
+   // JK of the level-R ancestor of jk
+   template <typename R>
+   static JK prefix_of(const JK& jk)
+   {
+      static_assert(level_of<R> < depth, "R is not a level of the path");
+      return JK::hierarchy::prefix(jk, level_of<R> + 1);
+   }
+
+   // Merged index over all levels, e.g. MergedIndex<LeanStoreMergedAdapter>
+   template <template <typename...> class Adapter>
+   using MergedIndex = Adapter<Levels...>;
+   template <template <typename...> class Scanner, typename JR>
+   using MergedScanner = Scanner<JK, JR, Levels...>;
+
+   // Lower bounds of a merged index range-partitioned by leading JK fields, e.g. for LeanStoreMergedAdapter: the folded
+   // set fields of the first JK of every partition after the first, such as {n, 0, 0, 0, 0}. A parent sorts before the
+   // bound of its first child, so an entry and its descendants may only be split across partitions at a bound
+   static std::vector<std::string> partition_bounds(const std::vector<JK>& starts)
+   {
+      std::vector<std::string> bounds;
+      for (const JK& start : starts) {
+         const FoldedJK<JK> folded(start);
+         bounds.emplace_back(reinterpret_cast<const char*>(folded.bytes), folded.length);
+      }
+      return bounds;
+   }
+
+   // From this level on, a parent has few entries of the level before the next parent, so the premerged join
+   // scans to the next entry instead of seeking as long as it has not measured otherwise
+   static constexpr size_t dense_from = depth >= 2 ? depth - 2 : 0;
+};
+
+// join_path_of<JK>::type is the JoinPath of JK, specialized next to each JK
+template <typename JK>
+struct join_path_of {
+};
+
+// Level from which joins over JK prefer scanning, see JoinPath::dense_from; the last two of `levels` without a path
+template <typename JK>
+constexpr size_t dense_levels_from(size_t levels)
+{
+   if constexpr (requires { join_path_of<JK>::type::dense_from; }) {
+      return join_path_of<JK>::type::dense_from;
+   } else {
+      return levels >= 2 ? levels - 2 : 0;
+   }
+}
@@ -116,6 +116,11 @@ void Logger::summarize_shared_stats()
       // 2 decimal places
       data.push_back(to_fixed(cpu_utilization * 100));
    }
+
+   for (auto& [name, value] : counters) {
+      header.push_back(name);
+      data.push_back(std::to_string(value));
+   }
 }
 
 void Logger::log_summary()
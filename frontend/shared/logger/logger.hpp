@@ -2,6 +2,8 @@
 #include <filesystem>
 #include <map>
 #include <string>
+#include <utility>
+#include <vector>
 #include <gflags/gflags.h>
 #include "Units.hpp"
 #include "leanstore/Config.hpp"
@@ -116,6 +118,7 @@ class Logger
    std::filesystem::path csv_db;
 
    SumStats stats;
+   std::vector<std::pair<std::string, long>> counters;  // of the workload, see set_counters()
 
    virtual void summarize_other_stats() = 0;
    void summarize_shared_stats();
@@ -139,6 +142,7 @@ class Logger
    virtual void reset()
    {
       stats.reset();
+      counters.clear();
       cpu_table.next();
       configs_table.next();
    }
@@ -164,6 +168,9 @@ class Logger
    void log_size();
    void log_sizes(std::map<std::string, double> sizes);
 
+   // Counters of the workload during the phase about to be logged, e.g. result cache hits, added as summary columns
+   void set_counters(std::vector<std::pair<std::string, long>> counters) { this->counters = std::move(counters); }
+
    virtual void prepare() = 0;
 
    void log_loading() { log(0, "load", "", 0); }
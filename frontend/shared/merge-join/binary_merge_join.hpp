@@ -1,56 +1,65 @@
 #pragma once
+#include "../scan_batch.hpp"
 #include "join_state.hpp"
 
 // sources -> join_state -> yield joined records
-template <typename JK, typename JR, typename R1, typename R2>
+// A source is either record-at-a-time (std::optional<std::pair<Key, Rec>>()) or batched (size_t(ScanBatch<Key, Rec>&), e.g. a scanner's
+// next_batch). Record-at-a-time sources are read exactly one record ahead, as they may have side effects.
+// With SourceCursor (a BatchCursor over SourceFetch) the sources are concrete types instead, see fused_join.hpp.
+template <typename JK,
+          typename JR,
+          typename R1,
+          typename R2,
+          typename LeftCursor = BatchCursor<typename R1::Key, R1>,
+          typename RightCursor = BatchCursor<typename R2::Key, R2>>
 struct BinaryMergeJoin {
    JK seek_jk = JK::max();
    JoinState<JK, JR, R1, R2> join_state;
-   std::function<std::optional<std::pair<typename R1::Key, R1>>()> fetch_left;
-   std::function<std::optional<std::pair<typename R2::Key, R2>>()> fetch_right;
-   std::optional<std::pair<typename R1::Key, R1>> next_left;
-   std::optional<std::pair<typename R2::Key, R2>> next_right;
+   LeftCursor left;
+   RightCursor right;
+   bool left_open = true;
+   bool right_open = true;
 
+   template <typename LeftSource, typename RightSource>
    BinaryMergeJoin(
-       std::function<std::optional<std::pair<typename R1::Key, R1>>()> fetch_left_func,
-       std::function<std::optional<std::pair<typename R2::Key, R2>>()> fetch_right_func,
+       LeftSource&& fetch_left,
+       RightSource&& fetch_right,
        const std::function<void(const typename JR::Key&, const JR&)>& consume_joined = [](const typename JR::Key&, const JR&) {})
 
-       : join_state("BinaryMergeJoin", consume_joined),
-         fetch_left(std::move(fetch_left_func)),
-         fetch_right(std::move(fetch_right_func)),
-         next_left(fetch_left()),
-         next_right(fetch_right())
+       : join_state("BinaryMergeJoin", consume_joined), left(std::forward<LeftSource>(fetch_left)), right(std::forward<RightSource>(fetch_right))
    {
-      // assert(next_left || next_right);  // at least one source must be available
+      // assert(has_left() || has_right());  // at least one source must be available
       refresh_join_state();  // initialize the join state with the smallest JK
    }
 
+   bool has_left() { return left_open && left.valid(); }
+   bool has_right() { return right_open && right.valid(); }
+
    void replace_sk(const JK& new_sk) { seek_jk = new_sk; }
 
    void refill_current_key()
    {
-      while (next_left && SKBuilder<JK>::create(next_left->first, next_left->second).match(join_state.jk_to_join) == 0) {
-         join_state.template emplace<R1, 0>(next_left->first, next_left->second);
-         next_left = fetch_left();
+      while (has_left() && SKBuilder<JK>::create(left.key(), left.record()).match(join_state.jk_to_join) == 0) {
+         join_state.template emplace<R1, 0>(left.key(), left.record());
+         left.advance();
       }
-      while (next_right && SKBuilder<JK>::create(next_right->first, next_right->second).match(join_state.jk_to_join) == 0) {
-         join_state.template emplace<R2, 1>(next_right->first, next_right->second);
-         next_right = fetch_right();
+      while (has_right() && SKBuilder<JK>::create(right.key(), right.record()).match(join_state.jk_to_join) == 0) {
+         join_state.template emplace<R2, 1>(right.key(), right.record());
+         right.advance();
       }
    }
 
    void refresh_join_state()
    {
-      JK left_jk = next_left ? SKBuilder<JK>::create(next_left->first, next_left->second) : JK::max();
+      JK left_jk = has_left() ? SKBuilder<JK>::create(left.key(), left.record()) : JK::max();
       if (seek_jk != JK::max() && left_jk.match(seek_jk) != 0) {
          left_jk = JK::max();
-         next_left = std::nullopt;
+         left_open = false;
       }
-      JK right_jk = next_right ? SKBuilder<JK>::create(next_right->first, next_right->second) : JK::max();
+      JK right_jk = has_right() ? SKBuilder<JK>::create(right.key(), right.record()) : JK::max();
       if (seek_jk != JK::max() && right_jk.match(seek_jk) != 0) {
          right_jk = JK::max();
-         next_right = std::nullopt;
+         right_open = false;
       }
 
       int comp = left_jk.match(right_jk);
@@ -76,7 +85,7 @@ struct BinaryMergeJoin {
    void run()
    {
       join_state.enable_logging();
-      while (next_left || next_right) {
+      while (has_left() || has_right()) {
          next();
       }
       while (join_state.has_next()) {
@@ -86,12 +95,18 @@ struct BinaryMergeJoin {
 
    std::optional<std::pair<typename JR::Key, JR>> next()
    {
-      while (!join_state.has_next() && (next_left || next_right)) {
+      while (!join_state.has_next() && (has_left() || has_right())) {
          next_jk();
       }
       return join_state.next();
    }
 
+   template <size_t N>
+   size_t next_batch(ScanBatch<typename JR::Key, JR, N>& batch)
+   {
+      return fill_batch(*this, batch);
+   }
+
    JK jk_to_join() const { return join_state.jk_to_join; }
    long produced() const { return join_state.get_produced(); }
 };
\ No newline at end of file
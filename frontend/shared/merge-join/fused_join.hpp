@@ -0,0 +1,30 @@
+#pragma once
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include "../scan_batch.hpp"
+#include "binary_merge_join.hpp"
+#include "hash_join.hpp"
+
+// Operator algebra over concrete source types: a source is any scanner or join with next() and next_batch().
+// The joins below hold their inputs by reference without std::function, so a whole pipeline such as
+// FusedMergeJoin<JK, nscci_t, FusedMergeJoin<JK, nsc_t, ...>, Scanner<city_t>> is visible to the compiler
+// and can be inlined into one loop. next()/run()/replace_sk() behave like BinaryMergeJoin and HashJoin.
+
+template <typename Source>
+using source_entry_t = typename std::remove_cvref_t<decltype(std::declval<Source&>().next())>::value_type;
+
+template <typename Source>
+using source_key_t = typename source_entry_t<Source>::first_type;
+
+template <typename Source>
+using source_record_t = typename source_entry_t<Source>::second_type;
+
+template <typename Source>
+using SourceCursorOf = SourceCursor<Source, source_key_t<Source>, source_record_t<Source>>;
+
+template <typename JK, typename JR, typename Left, typename Right>
+using FusedMergeJoin = BinaryMergeJoin<JK, JR, source_record_t<Left>, source_record_t<Right>, SourceCursorOf<Left>, SourceCursorOf<Right>>;
+
+template <typename JK, typename JR, typename Left, typename Right>
+using FusedHashJoin = HashJoin<JK, JR, source_record_t<Left>, source_record_t<Right>, SourceCursorOf<Left>, SourceCursorOf<Right>>;
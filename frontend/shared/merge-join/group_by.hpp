@@ -0,0 +1,207 @@
+#pragma once
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// Aggregate functions for StreamingGroupBy. Each one folds add(key, record) into its value and is reset
+// between groups; the getters map (key, record) to the aggregated column.
+namespace agg
+{
+struct Count {
+   long value = 0;
+
+   template <typename K, typename V>
+   void add(const K&, const V&)
+   {
+      value++;
+   }
+   void reset() { value = 0; }
+};
+
+template <typename T, typename Get>
+struct Sum {
+   Get get;
+   T value{};
+
+   template <typename K, typename V>
+   void add(const K& k, const V& v)
+   {
+      value += get(k, v);
+   }
+   void reset() { value = T{}; }
+};
+
+template <typename T, typename Get>
+struct Min {
+   Get get;
+   T value = std::numeric_limits<T>::max();
+
+   template <typename K, typename V>
+   void add(const K& k, const V& v)
+   {
+      value = std::min<T>(value, get(k, v));
+   }
+   void reset() { value = std::numeric_limits<T>::max(); }
+};
+
+template <typename T, typename Get>
+struct Max {
+   Get get;
+   T value = std::numeric_limits<T>::lowest();
+
+   template <typename K, typename V>
+   void add(const K& k, const V& v)
+   {
+      value = std::max<T>(value, get(k, v));
+   }
+   void reset() { value = std::numeric_limits<T>::lowest(); }
+};
+
+// Keeps the distinct values of the group, meant for low-cardinality columns such as c_mktsegment
+template <typename T, typename Get>
+struct DistinctCount {
+   Get get;
+   std::vector<T> seen;
+   long value = 0;
+
+   template <typename K, typename V>
+   void add(const K& k, const V& v)
+   {
+      const T& t = get(k, v);
+      if (std::find(seen.begin(), seen.end(), t) == seen.end()) {
+         seen.push_back(t);
+         value++;
+      }
+   }
+   void reset()
+   {
+      seen.clear();
+      value = 0;
+   }
+};
+
+template <typename T, typename Get>
+Sum<T, Get> sum(Get get)
+{
+   return Sum<T, Get>{std::move(get)};
+}
+
+template <typename T, typename Get>
+Min<T, Get> min(Get get)
+{
+   return Min<T, Get>{std::move(get)};
+}
+
+template <typename T, typename Get>
+Max<T, Get> max(Get get)
+{
+   return Max<T, Get>{std::move(get)};
+}
+
+template <typename T, typename Get>
+DistinctCount<T, Get> distinct_count(Get get)
+{
+   return DistinctCount<T, Get>{std::move(get)};
+}
+}  // namespace agg
+
+// GROUP BY over an input sorted on the group key, e.g. a sort_key_t prefix: records with equal keys are
+// consecutive, so only the open group is kept and each group is complete as soon as the key changes.
+// Inputs are scanners or joins; scanners with for_each_view() are read in place.
+template <typename GroupKey, typename KeyOf, typename... Aggs>
+class StreamingGroupBy
+{
+  public:
+   using Group = std::pair<GroupKey, std::tuple<Aggs...>>;
+
+   StreamingGroupBy(KeyOf key_of, Aggs... aggs) : key_of(std::move(key_of)), aggs(aggs...), done(GroupKey{}, std::tuple<Aggs...>(aggs...)) {}
+
+   // Adds a record, returns whether it completed the previous group (see completed())
+   template <typename K, typename V>
+   bool add(const K& k, const V& v)
+   {
+      const GroupKey key = key_of(k, v);
+      bool completed = false;
+      if (open_key.has_value() && !(*open_key == key)) {
+         complete();
+         completed = true;
+      }
+      open_key = key;
+      std::apply([&](auto&... a) { (a.add(k, v), ...); }, aggs);
+      return completed;
+   }
+
+   // Completes the open group at the end of the input, false if there is none
+   bool finish()
+   {
+      if (!open_key.has_value()) {
+         return false;
+      }
+      complete();
+      return true;
+   }
+
+   const Group& completed() const { return done; }
+
+   // Pulls from source until the next group is complete
+   template <typename Source>
+   std::optional<Group> next(Source& source)
+   {
+      if (pull(source) || finish()) {
+         return done;
+      }
+      return std::nullopt;
+   }
+
+   // Aggregates the whole source, calls emit(key, aggs...) per group and returns the number of groups
+   template <typename Source, typename Emit>
+   long run(Source& source, Emit&& emit)
+   {
+      long groups = 0;
+      while (pull(source) || finish()) {
+         std::apply([&](const auto&... a) { emit(done.first, a...); }, done.second);
+         groups++;
+      }
+      return groups;
+   }
+
+  private:
+   KeyOf key_of;
+   std::tuple<Aggs...> aggs;
+   std::optional<GroupKey> open_key;
+   Group done;
+
+   void complete()
+   {
+      done.first = *open_key;
+      std::swap(done.second, aggs);
+      std::apply([](auto&... a) { (a.reset(), ...); }, aggs);
+      open_key.reset();
+   }
+
+   // Adds records until one completes a group, false when the source is exhausted first
+   template <typename Source>
+   bool pull(Source& source)
+   {
+      if constexpr (requires { source.for_each_view([](const auto&, const auto&) { return true; }); }) {
+         // stops on the first record of the next group, which is already added
+         return source.for_each_view([&](const auto& k, const auto& v) { return !add(k, v); });
+      } else {
+         while (auto kv = source.next()) {
+            if (add(kv->first, kv->second)) {
+               return true;
+            }
+         }
+         return false;
+      }
+   }
+};
+
+template <typename GroupKey, typename KeyOf, typename... Aggs>
+StreamingGroupBy<GroupKey, KeyOf, Aggs...> group_by(KeyOf key_of, Aggs... aggs)
+{
+   return StreamingGroupBy<GroupKey, KeyOf, Aggs...>(std::move(key_of), std::move(aggs)...);
+}
@@ -1,4 +1,5 @@
 #pragma once
+#include <array>
 #include <cassert>
 #include <chrono>
 #include <cmath>
@@ -8,10 +9,15 @@
 #include <iostream>
 #include <map>
 #include <optional>
+#include "../bloom_filter.hpp"
+#include "../flat_hash_multimap.hpp"
+#include "../scan_batch.hpp"
 #include "../view_templates.hpp"
 #include "join_state.hpp"
 #include "leanstore/Config.hpp"
 
+DECLARE_bool(semi_join_filter);
+
 struct HashLogger {
    inline static std::ofstream log_file;
    inline static bool is_initialized = false;
@@ -67,25 +73,54 @@ struct HashLogger {
 };
 
 // sources -> join_state -> yield joined records
-template <typename JK, typename JR, typename R1, typename R2>
+// Sources are record-at-a-time or batched, see BinaryMergeJoin
+template <typename JK,
+          typename JR,
+          typename R1,
+          typename R2,
+          typename LeftCursor = BatchCursor<typename R1::Key, R1>,
+          typename RightCursor = BatchCursor<typename R2::Key, R2>>
 struct HashJoin {
    JK seek_jk = JK::max();
    const std::function<void(const typename JR::Key&, const JR&)> consume_joined;
    JoinState<JK, JR, R1, R2> state;
 
-   std::function<std::optional<std::pair<typename R1::Key, R1>>()> fetch_left;
-   std::function<std::optional<std::pair<typename R2::Key, R2>>()> fetch_right;
+   LeftCursor left;
+   RightCursor right;
+
+   FlatHashMultimap<JK, std::pair<typename R1::Key, R1>, std::hash<JK>> left_hashtable;
+   // Build sides of consecutive queries that select the same level are similar in size, pre-size the table from their
+   // running average. Per thread, so that concurrent joins do not race on it
+   static double& build_size_estimate(const JK& seek_jk)
+   {
+      static thread_local std::array<double, JK::hierarchy::depth + 1> estimates{};
+      return estimates[JK::hierarchy::selected_depth(seek_jk)];
+   }
+
+   // Matching keys of the next right entries, computed PROBE_PREFETCH_DISTANCE entries ahead of the
+   // probe so that their buckets are already in cache
+   static constexpr size_t PROBE_PREFETCH_DISTANCE = 8;
+   std::array<std::vector<JK>, PROBE_PREFETCH_DISTANCE> probe_keys;
+   size_t probe_head = 0;
+   size_t probe_prepared = 0;
 
-   typename std::unordered_multimap<JK, std::pair<typename R1::Key, R1>, std::hash<JK>> left_hashtable;
+   // Semi-join reduction: Bloom filter over the build JKs, checked before the hash table lookups and pushed
+   // into the right scanner when it accepts a filter, so that non-matching entries are dropped before copying
+   std::optional<SemiJoinFilter<JK>> semi_join_filter;
 
    double wait_us = 0;
 
+   template <typename LeftSource, typename RightSource>
    HashJoin(
-       std::function<std::optional<std::pair<typename R1::Key, R1>>()> fetch_left,
-       std::function<std::optional<std::pair<typename R2::Key, R2>>()> fetch_right,
+       LeftSource&& fetch_left,
+       RightSource&& fetch_right,
        const JK& seek_jk,
        const std::function<void(const typename JR::Key&, const JR&)>& consume_joined = [](const typename JR::Key&, const JR&) {})
-       : seek_jk(seek_jk), consume_joined(consume_joined), state("HashJoin", consume_joined), fetch_left(fetch_left), fetch_right(fetch_right)
+       : seek_jk(seek_jk),
+         consume_joined(consume_joined),
+         state("HashJoin", consume_joined),
+         left(std::forward<LeftSource>(fetch_left)),
+         right(std::forward<RightSource>(fetch_right))
    {
       std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
       build_phase();
@@ -94,58 +129,87 @@ struct HashJoin {
       wait_us = d / 1000.0 - build_us;
    }
 
-   ~HashJoin() { HashLogger::log1(state.get_produced(), build_us, wait_us, hash_table_bytes()); }
+   ~HashJoin()
+   {
+      if constexpr (requires { right.underlying().set_filter(nullptr); }) {
+         if (semi_join_filter) {
+            right.underlying().set_filter(nullptr);
+         }
+      }
+      HashLogger::log1(state.get_produced(), build_us, wait_us, hash_table_bytes());
+   }
 
-   long hash_table_bytes() const { return left_hashtable.size() * (sizeof(JK) + sizeof(typename R1::Key) + sizeof(R1)); }
+   long hash_table_bytes() const { return left_hashtable.bytes() + (semi_join_filter ? semi_join_filter->bytes() : 0); }
 
    double build_us = 0;
 
    void build_phase()
    {
       std::optional<std::chrono::high_resolution_clock::time_point> start = std::nullopt;
+      double& estimate = build_size_estimate(seek_jk);
+      left_hashtable.reserve(static_cast<size_t>(estimate * 1.25));
       while (true) {
-         auto kv = fetch_left();
+         const bool has_left = left.valid();
          if (!start.has_value()) {
             start = std::chrono::high_resolution_clock::now();
          }
-         if (!kv.has_value()) {
+         if (!has_left) {
             break;
          }
-         auto& [k, v] = *kv;
+         const auto& k = left.key();
+         const auto& v = left.record();
          JK curr_jk = SKBuilder<JK>::create(k, v);
          if (seek_jk != JK::max() && curr_jk.match(seek_jk) != 0) {
             break;
          }
          left_hashtable.emplace(curr_jk, std::make_pair(k, v));
+         left.advance();
+      }
+      estimate = estimate == 0 ? left_hashtable.size() : 0.75 * estimate + 0.25 * left_hashtable.size();
+      if (FLAGS_semi_join_filter) {
+         build_semi_join_filter();
       }
       std::chrono::high_resolution_clock::time_point end = std::chrono::high_resolution_clock::now();
       auto build_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - *start).count();
       build_us = build_ns / 1000.0;
    }
 
+   void build_semi_join_filter()
+   {
+      semi_join_filter.emplace(left_hashtable.distinct_keys());
+      left_hashtable.for_each_key([&](const JK& jk) { semi_join_filter->insert(jk); });
+      if constexpr (requires { right.underlying().set_filter(semi_join_filter->template probe_predicate<R1, R2>(seek_jk)); }) {
+         right.underlying().set_filter(semi_join_filter->template probe_predicate<R1, R2>(seek_jk));
+      }
+   }
+
    bool probe_next()
    {
       assert(!state.has_next());
-      auto right_kv = fetch_right();
-      if (!right_kv.has_value()) {
+      if (!right.valid()) {
          return false;
       }
-      auto& [rk, rv] = *right_kv;
+      prefetch_probes();
+      const auto& rk = right.key();
+      const auto& rv = right.record();
       JK curr_jk = SKBuilder<JK>::create(rk, rv);
       if (seek_jk != JK::max() && curr_jk.match(seek_jk) != 0) {
          return false;
       }
       JK last_jk = state.jk_to_join;
       state.template emplace<R2, 1>(rk, rv);
-      auto keys_to_match = curr_jk.matching_keys();
-      for (const auto& lsk : keys_to_match) {
-         auto range = left_hashtable.equal_range(lsk);
-         for (auto it = range.first; it != range.second; ++it) {
-            auto& [jk, l] = *it;
+      right.advance();
+      for (const auto& lsk : probe_keys[probe_head]) {
+         if (semi_join_filter && !semi_join_filter->may_contain(lsk)) {
+            continue;
+         }
+         left_hashtable.for_each_equal(lsk, [&](const auto& l) {
             auto& [lk, lv] = l;
             state.template emplace<R1, 0>(lk, lv);
-         }
+         });
       }
+      probe_head = (probe_head + 1) % PROBE_PREFETCH_DISTANCE;
+      probe_prepared--;
       state.refresh(JK::max()); // reset cached records at every step, because the right side come in no order, so can't assume the left cached records can still match with future right records
 
       if (state.get_produced() != 0 && !state.has_next()) {
@@ -156,6 +220,21 @@ struct HashJoin {
       return true;  // can probe next even if joined nothing
    }
 
+   // Computes the matching keys of the buffered right entries up to PROBE_PREFETCH_DISTANCE ahead and
+   // prefetches their buckets; includes the current entry
+   void prefetch_probes()
+   {
+      const size_t ahead = std::min(PROBE_PREFETCH_DISTANCE, right.buffered());
+      for (; probe_prepared < ahead; probe_prepared++) {
+         JK jk = SKBuilder<JK>::create(right.key_at(probe_prepared), right.record_at(probe_prepared));
+         auto& keys = probe_keys[(probe_head + probe_prepared) % PROBE_PREFETCH_DISTANCE];
+         keys = jk.matching_keys();
+         for (const auto& lsk : keys) {
+            left_hashtable.prefetch(lsk);
+         }
+      }
+   }
+
    void run()
    {
       state.enable_logging();
@@ -179,6 +258,12 @@ struct HashJoin {
       }
       return next();
    }
+   template <size_t N>
+   size_t next_batch(ScanBatch<typename JR::Key, JR, N>& batch)
+   {
+      return fill_batch(*this, batch);
+   }
+
    // tricky to implement went_past
    // tricky to implement jk_to_join
    long produced() const { return state.get_produced(); }
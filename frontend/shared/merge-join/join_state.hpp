@@ -1,9 +1,10 @@
 #pragma once
+#include <algorithm>
+#include <array>
 #include <cstddef>
 #include <functional>
 
 #include <optional>
-#include <queue>
 #include <variant>
 #include <vector>
 #include "../variant_tuple_utils.hpp"
@@ -53,18 +54,42 @@ class JoinState
       update_print_produced(curr_joined);
    }
 
+   // Owned copy of the next joined record, also handed to consume_joined
    std::optional<std::pair<typename JR::Key, JR>> next()
    {
-      if (joined_records.empty()) {
+      if (!has_next()) {
          return std::nullopt;
       }
-      auto joined_pair = joined_records.front();
-      joined_records.pop();
+      auto joined_pair = materialize(peek());
+      advance();
       consume_joined(joined_pair.first, joined_pair.second);
       return joined_pair;
    }
 
-   bool has_next() const { return !joined_records.empty(); }
+   bool has_next() const { return pending > 0; }
+
+   // References to the source records forming the next joined record, valid until advance()
+   using JoinedView = std::tuple<const std::pair<typename Rs::Key, Rs>&...>;
+   JoinedView peek() const { return peek(std::index_sequence_for<Rs...>{}); }
+
+   // Moves the odometer to the next combination, the last source turning fastest
+   void advance()
+   {
+      assert(pending > 0);
+      pending--;
+      for (size_t i = nways; i-- > 0;) {
+         if (++positions[i] < sizes[i]) {
+            break;
+         }
+         positions[i] = 0;
+      }
+   }
+
+   static std::pair<typename JR::Key, JR> materialize(const JoinedView& view)
+   {
+      return std::apply([](const auto&... pairs) { return std::pair<typename JR::Key, JR>(typename JR::Key{pairs.first...}, JR{pairs.second...}); },
+                        view);
+   }
 
    template <typename Record, size_t I>
    void emplace(const typename Record::Key& key, const Record& rec)
@@ -90,7 +115,7 @@ class JoinState
 
    long get_produced() const
    {
-      size_t joined_not_produced = joined_records.size();
+      size_t joined_not_produced = pending;
       if (joined_not_produced > 0) {
          std::cerr << "WARNING: JoinState: get_produced() called while there are still " << joined_not_produced << " joined records in the queue." << std::endl;
       }
@@ -105,76 +130,68 @@ class JoinState
    }
 
   private:
+   static constexpr size_t nways = sizeof...(Rs);
    bool logging = false;
    std::tuple<std::vector<std::pair<typename Rs::Key, Rs>>...> records_to_join = {};
-   std::queue<std::pair<typename JR::Key, JR>> joined_records = {};
+   // Groups cleared by refresh() while their combinations are still being produced, swapped back and
+   // reused afterwards so that the vectors keep their capacity
+   std::tuple<std::vector<std::pair<typename Rs::Key, Rs>>...> retired_records = {};
+   // Odometer over the cached records: nothing is materialized until next()
+   std::array<bool, nways> from_retired = {};
+   std::array<size_t, nways> sizes = {};
+   std::array<size_t, nways> positions = {};
+   size_t pending = 0;
 
    long joined = 0;
 
    const std::function<void(const typename JR::Key&, const JR&)> consume_joined;
    const std::string msg;
 
-   template <size_t... Is>
-   void assemble_joined_records(std::vector<std::tuple<std::pair<typename Rs::Key, Rs>...>>& cartesian_product,
-                                unsigned long* batch_size,
-                                size_t len_cartesian_product,
-                                std::index_sequence<Is...>)
+   template <size_t I>
+   const auto& source_records() const
    {
-      (..., ([&] {
-          auto& vec = std::get<Is>(records_to_join);
-          size_t repeat = *batch_size / vec.size(), batch = len_cartesian_product / *batch_size;
-          for (size_t b = 0; b < batch; ++b)
-             for (size_t r = 0; r < repeat; ++r)
-                for (size_t j = 0; j < vec.size(); ++j) {
-                   auto& pairs = cartesian_product.at(b * *batch_size + j * repeat + r);
-                   std::get<Is>(pairs) = vec.at(j);
-                }
-          *batch_size /= vec.size();
-       })());
+      return from_retired[I] ? std::get<I>(retired_records) : std::get<I>(records_to_join);
    }
 
-   int join_current()
+   template <size_t... Is>
+   JoinedView peek(std::index_sequence<Is...>) const
    {
-      size_t len_cartesian_product = 1;  // how many records the cached records can join and produce
-      for_each(records_to_join, [&](const auto& v) { len_cartesian_product *= v.size(); });
-      if (len_cartesian_product == 0)
-         return 0;
-
-      // assign the cached records to the cartesian product to be joined
-      std::vector<std::tuple<std::pair<typename Rs::Key, Rs>...>> cartesian_product(len_cartesian_product);
-      unsigned long batch_size = len_cartesian_product;
-      assemble_joined_records(cartesian_product, &batch_size, len_cartesian_product, std::index_sequence_for<Rs...>{});
-
-      // actually joining the records
-      for (auto& cartesian_product_instance : cartesian_product) {
-         typename JR::Key joined_key;
-         JR joined_rec;
-         std::apply(
-             [&joined_key, &joined_rec](auto&... pairs) {
-                joined_key = typename JR::Key{std::get<0>(pairs)...};
-                joined_rec = JR{std::get<1>(pairs)...};
-             },
-             cartesian_product_instance);
-         joined_records.emplace(joined_key, joined_rec);
-      }
-      return static_cast<int>(len_cartesian_product);
+      return JoinedView(source_records<Is>()[positions[Is]]...);
    }
 
    template <size_t... Is>
    int join_and_clear(const JK& next_jk, std::index_sequence<Is...>)
    {
-      int joined_cnt = 0;
+      std::array<bool, nways> expired = {};
+      (..., ([&] {
+          using RecordType = std::tuple_element_t<Is, std::tuple<Rs...>>;
+          expired[Is] = next_jk.match(SKBuilder<JK>::template get<RecordType>(jk_to_join)) != 0;
+       }()));
+      jk_to_join = next_jk;
+      if (std::find(expired.begin(), expired.end(), true) == expired.end()) {
+         return 0;
+      }
+      if (pending > 0) {
+         throw std::runtime_error(
+             "JoinState: refresh() while joined records are pending. Are you calling JoinState::next()? JoinState is only supposed to be a "
+             "pipeline instead of a storage!");
+      }
+      size_t len_cartesian_product = 1;  // how many records the cached records can join and produce
+      for_each(records_to_join, [&](const auto& v) { len_cartesian_product *= v.size(); });
+      // start the odometer over the current groups; the expired ones move aside so that records of the
+      // next key can be cached while the combinations are still consumed
       (..., ([&] {
           auto& vec = std::get<Is>(records_to_join);
-          using VecElem = typename std::remove_reference_t<decltype(vec)>::value_type;
-          using RecordType = std::tuple_element_t<1, VecElem>;
-          if (next_jk.match(SKBuilder<JK>::template get<RecordType>(jk_to_join)) != 0) {
-             joined_cnt += join_current();
+          sizes[Is] = vec.size();
+          positions[Is] = 0;
+          from_retired[Is] = expired[Is];
+          if (expired[Is]) {
+             std::swap(vec, std::get<Is>(retired_records));
              vec.clear();
           }
        }()));
-      jk_to_join = next_jk;
-      return joined_cnt;
+      pending = len_cartesian_product;
+      return static_cast<int>(len_cartesian_product);
    }
 
    long last_logged = 0;
@@ -187,10 +204,5 @@ class JoinState
          std::cout << "\r" << msg << ": joined " << progress << "k records at JK " << jk_to_join << "------------------------------------";
          last_logged = joined;
       }
-      if (joined_records.size() > 1000 && joined_records.size() > static_cast<size_t>(curr_joined)) {
-         throw std::runtime_error(
-             "JoinState: too many joined records in the queue. Are you calling JoinState::next()? JoinState is only supposed to be a pipeline "
-             "instead of a storage!");
-      }
    }
 };
\ No newline at end of file
@@ -0,0 +1,130 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "Units.hpp"
+
+// K-way merge of typed sources by JK. Each source owns one inline slot holding its current record, the
+// winner is selected with a loser tree (one comparison per level on replay, and the JKs sit in a
+// contiguous array), and consumers receive typed references to the slot: no serialization, no allocation
+// per merged record
+template <typename JK, typename... Rs>
+struct LoserTree {
+   static constexpr size_t nways = sizeof...(Rs);
+   static constexpr size_t nleaves = std::bit_ceil(nways);
+   static_assert(nways > 0 && nways < std::numeric_limits<u8>::max());
+
+   template <typename R>
+   using Source = std::function<std::optional<std::pair<typename R::Key, R>>()>;
+   using Sources = std::tuple<Source<Rs>...>;
+
+   template <typename R>
+   struct Slot {
+      typename R::Key k;
+      R v;
+   };
+
+   Sources sources;
+   std::tuple<Slot<Rs>...> slots;
+   // JK::max() marks an exhausted source and the padding leaves
+   std::array<JK, nleaves> jks;
+   // losers[0] is the overall winner, losers[n] the loser of the match at inner node n
+   std::array<u8, nleaves> losers;
+   long sifted = 0;
+
+   explicit LoserTree(Sources sources) : sources(std::move(sources)) { jks.fill(JK::max()); }
+
+   // Any source with next() returning std::optional<std::pair<R::Key, R>>, e.g. a scanner or a join
+   template <typename... SourceTypes>
+      requires(sizeof...(SourceTypes) == nways)
+   explicit LoserTree(SourceTypes&... sources) : LoserTree(Sources{[&sources]() { return sources.next(); }...})
+   {
+   }
+
+   void init()
+   {
+      refill_all(std::index_sequence_for<Rs...>{});
+      std::array<u8, 2 * nleaves> winners;
+      for (size_t i = 0; i < nleaves; i++) {
+         winners[nleaves + i] = i;
+      }
+      for (size_t n = nleaves - 1; n >= 1; n--) {
+         u8 l = winners[2 * n], r = winners[2 * n + 1];
+         if (less(r, l)) {
+            std::swap(l, r);
+         }
+         winners[n] = l;
+         losers[n] = r;
+      }
+      losers[0] = winners[1];
+   }
+
+   bool has_next() const { return jks[losers[0]] != JK::max(); }
+
+   const JK& current_jk() const { return jks[losers[0]]; }
+
+   // Hands the smallest record to visit(std::integral_constant<size_t, I>, const Key&, const R&), then
+   // advances its source. The references are only valid during the call
+   template <typename Visitor>
+   void next(Visitor&& visit)
+   {
+      const u8 winner = losers[0];
+      sifted++;
+      dispatch(winner, std::forward<Visitor>(visit), std::index_sequence_for<Rs...>{});
+      replay(winner);
+   }
+
+   template <typename Visitor>
+   void run(Visitor&& visit)
+   {
+      while (has_next()) {
+         next(visit);
+      }
+   }
+
+  private:
+   bool less(u8 a, u8 b) const { return jks[a] < jks[b] || (jks[a] == jks[b] && a < b); }
+
+   template <size_t I>
+   void refill()
+   {
+      auto kv = std::get<I>(sources)();
+      if (!kv) {
+         jks[I] = JK::max();
+         return;
+      }
+      auto& slot = std::get<I>(slots);
+      slot.k = kv->first;
+      slot.v = kv->second;
+      jks[I] = SKBuilder<JK>::create(slot.k, slot.v);
+   }
+
+   template <size_t... Is>
+   void refill_all(std::index_sequence<Is...>)
+   {
+      (refill<Is>(), ...);
+   }
+
+   template <typename Visitor, size_t... Is>
+   void dispatch(u8 source, Visitor&& visit, std::index_sequence<Is...>)
+   {
+      ((source == Is ? (visit(std::integral_constant<size_t, Is>{}, std::get<Is>(slots).k, std::get<Is>(slots).v), refill<Is>(), true) : false) || ...);
+   }
+
+   // Re-runs the matches on the path from the refilled leaf to the root
+   void replay(u8 source)
+   {
+      u8 winner = source;
+      for (size_t n = (nleaves + source) / 2; n >= 1; n /= 2) {
+         if (less(losers[n], winner)) {
+            std::swap(losers[n], winner);
+         }
+      }
+      losers[0] = winner;
+   }
+};
@@ -1,66 +1,62 @@
 #pragma once
-#include "heap.hpp"
+#include <functional>
+#include <iostream>
+#include <tuple>
 #include "leanstore/Config.hpp"
+#include "loser_tree.hpp"
 
+// Copies the records of the scanners into a merged adapter in JK order, through the same loser tree as MergeJoin
 template <typename JK, typename... Rs>
 struct Merge {
-   Heap<JK, Rs...> heap_merge;
+   LoserTree<JK, Rs...> tree_merge;
+   std::tuple<std::function<void(const typename Rs::Key&, const Rs&)>...> inserts;
    bool logging = false;
 
-   template <typename MergedAdapterType, template <typename> class ScannerType, typename... SourceRecords>
-   Merge(MergedAdapterType& mergedAdapter, ScannerType<SourceRecords>&... scanners)
-       : heap_merge(getHeapConsumesToMerged<MergedAdapterType, SourceRecords...>(mergedAdapter), scanners...)
+   template <typename MergedAdapterType, template <typename> class ScannerType>
+   Merge(MergedAdapterType& mergedAdapter, ScannerType<Rs>&... scanners)
+       : tree_merge(scanners...), inserts{[&mergedAdapter](const typename Rs::Key& k, const Rs& v) { mergedAdapter.insert(k, v); }...}
    {
-      heap_merge.init();
+      tree_merge.init();
    }
 
    ~Merge()
    {
-      if (heap_merge.sifted > 1000)
-         std::cout << "~Merge: produced " << (double)heap_merge.sifted / 1000 << "k records------------------------------------" << std::endl;
+      if (tree_merge.sifted > 1000)
+         std::cout << "~Merge: produced " << (double)tree_merge.sifted / 1000 << "k records------------------------------------" << std::endl;
    }
 
    void printProgress()
    {
-      if (heap_merge.current_jk % 10 == 0 && FLAGS_log_progress) {
-         double progress = (double)heap_merge.sifted / 1000;
+      if (logging && tree_merge.sifted % 1000 == 0 && FLAGS_log_progress) {
+         double progress = (double)tree_merge.sifted / 1000;
          std::cout << "\rMerge: " << progress << "k records------------------------------------";
       }
    }
 
-   template <typename MergedAdapterType, typename RecordType, typename SourceRecord>
-   auto getHeapConsumeToMerged(MergedAdapterType& mergedAdapter)
-   {
-      return [&mergedAdapter, this](HeapEntry<JK>& entry) {
-         heap_merge.current_entry = entry;
-         auto source_k = SourceRecord::template fromBytes<typename SourceRecord::Key>(entry.k);
-         auto source_v = SourceRecord::template fromBytes<SourceRecord>(entry.v);
-         mergedAdapter.insert(typename RecordType::Key(source_k, source_v), RecordType(source_v));
-         printProgress();
-      };
-   }
-
-   template <typename MergedAdapterType, typename... SourceRecords>
-   std::vector<std::function<void(HeapEntry<JK>&)>> getHeapConsumesToMerged(MergedAdapterType& mergedAdapter)
-   {
-      return {getHeapConsumeToMerged<MergedAdapterType, Rs, SourceRecords>(mergedAdapter)...};
-   }
-
    void run()
    {
       logging = true;
-      heap_merge.run();
+      while (tree_merge.has_next()) {
+         next();
+      }
    }
 
    void next_jk()
    {
-      JK start_jk = heap_merge.current_jk;
-      while (heap_merge.current_jk == start_jk && heap_merge.has_next()) {
-         heap_merge.next();
+      const JK start_jk = tree_merge.current_jk();
+      while (tree_merge.has_next() && tree_merge.current_jk() == start_jk) {
+         next();
       }
    }
 
-   JK current_jk() const { return heap_merge.current_jk; }
+   JK current_jk() const { return tree_merge.current_jk(); }
+
+   long produced() const { return tree_merge.sifted; }
 
-   long produced() const { return heap_merge.sifted; }
-};
\ No newline at end of file
+  private:
+   void next()
+   {
+      tree_merge.next([this](auto source, const auto& k, const auto& v) { std::get<decltype(source)::value>(inserts)(k, v); });
+      printProgress();
+   }
+};
@@ -1,59 +1,36 @@
 #pragma once
-#include "heap.hpp"
 #include "join_state.hpp"
+#include "loser_tree.hpp"
 
-// source -> heap -> join_state (consume) -> yield joined records
+// source -> loser tree -> join_state (consume) -> yield joined records
 template <typename JK, typename JR, typename... Rs>
 struct MergeJoin {
-   Heap<JK, Rs...> heap_merge;
+   using Sources = typename LoserTree<JK, Rs...>::Sources;
+   LoserTree<JK, Rs...> tree_merge;
    JoinState<JK, JR, Rs...> join_state;
 
    template <template <typename> class ScannerType>
    MergeJoin(
        ScannerType<Rs>&... scanners,
-       std::function<void(const typename JR::Key&, const JR&)>& consume_joined = [](const typename JR::Key&, const JR&) {})
-       : heap_merge(getHeapConsumesToBeJoined(), scanners...), join_state("MergeJoin", consume_joined)
+       const std::function<void(const typename JR::Key&, const JR&)>& consume_joined = [](const typename JR::Key&, const JR&) {})
+       : tree_merge(scanners...), join_state("MergeJoin", consume_joined)
    {
-      heap_merge.init();
+      tree_merge.init();
    }
 
    MergeJoin(
-       std::vector<std::function<HeapEntry<JK>()>>& sources,
-       std::function<void(const typename JR::Key&, const JR&)>& consume_joined = [](const typename JR::Key&, const JR&) {})
-       : heap_merge(sources, getHeapConsumesToBeJoined()), join_state("MergeJoin", consume_joined)
+       Sources sources,
+       const std::function<void(const typename JR::Key&, const JR&)>& consume_joined = [](const typename JR::Key&, const JR&) {})
+       : tree_merge(std::move(sources)), join_state("MergeJoin", consume_joined)
    {
-      heap_merge.init();
+      tree_merge.init();
    }
 
    template <template <typename> class AdapterType, template <typename> class ScannerType>
    MergeJoin(AdapterType<JR>& joinedAdapter, ScannerType<Rs>&... scanners)
-       : heap_merge(getHeapConsumesToBeJoined(), scanners...),
-         join_state("MergeJoin", [&](const auto& k, const auto& v) { joinedAdapter.insert(k, v); })
+       : tree_merge(scanners...), join_state("MergeJoin", [&](const auto& k, const auto& v) { joinedAdapter.insert(k, v); })
    {
-      heap_merge.init();
-   }
-
-   template <typename R, size_t I>
-   auto getHeapConsumeToBeJoined()
-   {
-      return [this](HeapEntry<JK>& entry) {
-         // heap_merge.current_entry = entry;
-         if (entry.jk.match(join_state.jk_to_join) != 0) {
-            join_state.refresh(entry.jk);
-         }
-         join_state.emplace<I>(typename R::Key(R::template fromBytes<typename R::Key>(entry.k)), CurrRec(R::template fromBytes<R>(entry.v)));
-      };
-   }
-
-   template <size_t... Is>
-   std::vector<std::function<void(HeapEntry<JK>&)>> getHeapConsumesToBeJoined(std::index_sequence<Is...>)
-   {
-      return {getHeapConsumeToBeJoined<Rs, Is>()...};
-   }
-
-   std::vector<std::function<void(HeapEntry<JK>&)>> getHeapConsumesToBeJoined()
-   {
-      return getHeapConsumesToBeJoined(std::index_sequence_for<Rs...>{});
+      tree_merge.init();
    }
 
    bool went_past(const JK& match_jk) const { return join_state.went_past(match_jk); }
@@ -63,13 +40,20 @@ struct MergeJoin {
    void run()
    {
       join_state.enable_logging();
-      heap_merge.run();
+      while (next()) {
+      }
    }
 
    std::optional<std::pair<typename JR::Key, JR>> next()
    {
-      while (!join_state.has_next() && heap_merge.has_next()) {
-         heap_merge.next();
+      while (!join_state.has_next()) {
+         if (tree_merge.has_next()) {
+            merge_next();
+         } else if (join_state.jk_to_join != JK::max()) {
+            join_state.refresh(JK::max());  // join the last cached group
+         } else {
+            break;
+         }
       }
       return join_state.next();
    }
@@ -77,4 +61,17 @@ struct MergeJoin {
    JK jk_to_join() const { return join_state.jk_to_join; }
 
    long produced() const { return join_state.get_produced(); }
-};
\ No newline at end of file
+
+  private:
+   void merge_next()
+   {
+      tree_merge.next([this](auto source, const auto& k, const auto& v) {
+         using R = std::remove_cvref_t<decltype(v)>;
+         const JK jk = SKBuilder<JK>::create(k, v);
+         if (jk.match(join_state.jk_to_join) != 0) {
+            join_state.refresh(jk);
+         }
+         join_state.template emplace<R, decltype(source)::value>(k, v);
+      });
+   }
+};
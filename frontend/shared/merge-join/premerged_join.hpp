@@ -1,15 +1,22 @@
 #pragma once
 #include <gflags/gflags_declare.h>
 #include <algorithm>
+#include <array>
+#include <chrono>
 #include <fstream>
 #include <functional>
 #include <mutex>
 #include <variant>
+#include "../cost_learner.hpp"
+#include "../join_path.hpp"
+#include "../scan_batch.hpp"
 #include "join_state.hpp"
 
 DECLARE_int32(tentative_skip_bytes);
+DECLARE_bool(adaptive_premerged_join);
 
 struct PremergedJoinStats; // Forward declaration
+struct PremergedCostModel;
 
 // Centralized logger class
 class PremergedJoinLogger
@@ -17,6 +24,8 @@ class PremergedJoinLogger
   public:
    // This is the main interface for logging stats
    static void log(const PremergedJoinStats& stats, size_t remaining_records_to_join, long produced);
+   // Keeps the latest learned seek/scan costs, written on flush
+   static void log_model(const PremergedCostModel& model);
    // Flushes any pending stats to the log file.
    static void flush();
 
@@ -28,6 +37,8 @@ class PremergedJoinLogger
 
    inline static std::ofstream log_file;
    static PremergedJoinStats last_stats;
+   static PremergedCostModel last_model;
+   inline static bool has_model = false;
    inline static long long remaining_records_to_join_accumulated = 0;
    inline static long long produced_accumulated = 0;
    inline static size_t repeat_count = 0;
@@ -44,6 +55,8 @@ struct PremergedJoinStats {
    size_t scan_filter_success = 0;
    size_t scan_filter_fail = 0;
    size_t emplace_cnt = 0;
+   size_t chose_seek = 0;  // decisions of the cost model
+   size_t chose_scan = 0;
 
    // Default constructor for static initialization
    PremergedJoinStats() : record_type_count(0) {}
@@ -55,12 +68,61 @@ struct PremergedJoinStats {
    bool operator==(const PremergedJoinStats& other) const
    {
       return record_type_count == other.record_type_count && seek_cnt == other.seek_cnt && right_next_cnt == other.right_next_cnt &&
-             scan_filter_success == other.scan_filter_success && scan_filter_fail == other.scan_filter_fail && emplace_cnt == other.emplace_cnt;
+             scan_filter_success == other.scan_filter_success && scan_filter_fail == other.scan_filter_fail && emplace_cnt == other.emplace_cnt &&
+             chose_seek == other.chose_seek && chose_scan == other.chose_scan;
    }
 
    bool operator!=(const PremergedJoinStats& other) const { return !(*this == other); }
 };
 
+// Learned costs behind PremergedJoin::get_next (--adaptive_premerged_join). Per key field at which the next
+// target differs from the cached key, the entries a scan inspects per unit of key distance (fanout), plus the
+// cost of inspecting one entry and of one seek, as moving averages over the executed steps.
+struct PremergedCostModel {
+   static constexpr size_t FIELDS = 8;
+   static constexpr double SCAN_BUDGET = 4;  // scans give up after this many times the expected entries
+
+   std::array<double, FIELDS> fanout{};  // 0 while unknown
+   std::array<size_t, FIELDS> decisions{};
+   double scan_ns_per_entry = 0;
+   double seek_ns = 0;
+
+   static size_t field_of(int field) { return std::min<size_t>(field, FIELDS - 1); }
+
+   double expected_entries(int field, int dist) const { return fanout[field_of(field)] * dist; }
+
+   // prior: the static choice, used until both actions have been observed. The other action is tried every
+   // CostLearner::EXPLORE_EVERY decisions per field from the start, and a field without a fanout is scanned first, so that every field
+   // is measured whatever its prior
+   bool prefer_scan(int field, int dist, bool prior)
+   {
+      const size_t f = field_of(field);
+      const bool explore = CostLearner::explore(decisions[f]);
+      if (fanout[f] == 0) {
+         return decisions[f] == 1 || explore || prior;
+      }
+      if (scan_ns_per_entry == 0 || seek_ns == 0) {
+         return explore ? !prior : prior;
+      }
+      const bool scan = expected_entries(field, dist) * scan_ns_per_entry < seek_ns;
+      return explore ? !scan : scan;
+   }
+
+   void observe_seek(double ns) { seek_ns = CostLearner::update(seek_ns, ns); }
+
+   // found: the target was reached by inspecting the entries, otherwise the scan gave up after them
+   void observe_scan(int field, int dist, size_t inspected, double ns, bool found)
+   {
+      if (inspected == 0 || dist <= 0) {
+         return;
+      }
+      scan_ns_per_entry = CostLearner::update(scan_ns_per_entry, ns / inspected);
+      double& f = fanout[field_of(field)];
+      const double per_unit = static_cast<double>(inspected) / dist;
+      f = CostLearner::update(f, found ? per_unit : std::max(f, per_unit) * 2);  // a failed scan only bounds the fanout from below
+   }
+};
+
 // merged_scanner -> join_state -> yield joined records
 template <typename MergedScannerType, typename JK, typename JR, typename... Rs>
 struct PremergedJoin {
@@ -71,6 +133,36 @@ struct PremergedJoin {
 
    using K = std::variant<typename Rs::Key...>;
    using V = std::variant<Rs...>;
+   // levels from which to scan rather than seek for the next entry, from the JoinPath of JK
+   static constexpr size_t DENSE_FROM = dense_levels_from<JK>(sizeof...(Rs));
+   // Every Rs[i] is keyed by the first i + 1 JK fields, so scanned keys compare with a FoldedJK
+   static constexpr bool FOLDED_PREFIX_KEYS = []<size_t... Is>(std::index_sequence<Is...>) {
+      if constexpr (requires { JK::hierarchy::prefix_lengths; }) {
+         if constexpr (sizeof...(Rs) <= JK::hierarchy::depth) {
+            return ((Rs::maxFoldLength() == JK::hierarchy::prefix_lengths[Is + 1]) && ...);
+         }
+      }
+      return false;
+   }(std::index_sequence_for<Rs...>{});
+   static constexpr bool COMPARE_FOLDED = FOLDED_PREFIX_KEYS && requires(MergedScannerType& s, u8* out) {
+      s.advance();
+      s.folded_key(out);
+      s.consume();
+   };
+   static constexpr unsigned MAX_KEY_LENGTH = std::max({Rs::maxFoldLength()...});
+
+   // Lookahead buffer over the merged scanner. Only the plain scanning loop in next() reads ahead in batches;
+   // seeks and page probes (last_in_page) need the scanner positioned on the last returned entry.
+   ScanBatch<K, V> lookahead;
+   size_t lookahead_pos = 0;
+   // Shared by the joins of this type on a thread, so that each query starts from what earlier ones learned
+   inline static thread_local PremergedCostModel cost_model;
+   size_t inspected = 0;  // entries looked at by the last scan_filter_next/skip_filter_next
+   struct Scanned {
+      const K& k;
+      const V& v;
+      JK jk;
+   };
 
    PremergedJoin(
        MergedScannerType& merged_scanner,
@@ -85,7 +177,13 @@ struct PremergedJoin {
    {
    }
 
-   ~PremergedJoin() { PremergedJoinLogger::log(stats, join_state.get_remaining_records_to_join(), join_state.get_produced()); }
+   ~PremergedJoin()
+   {
+      PremergedJoinLogger::log(stats, join_state.get_remaining_records_to_join(), join_state.get_produced());
+      if (FLAGS_adaptive_premerged_join) {
+         PremergedJoinLogger::log_model(cost_model);
+      }
+   }
 
    void replace_sk(const JK& new_sk) { seek_jk = new_sk; }
 
@@ -101,22 +199,58 @@ struct PremergedJoin {
       stats.emplace_cnt++;
    }
 
-   std::optional<std::tuple<K, V, JK>> scan_next(bool to_emplace = true)
+   bool refill(bool batched)
    {
+      lookahead_pos = 0;
+      if constexpr (requires { merged_scanner.next_batch(lookahead); }) {
+         if (batched) {
+            return merged_scanner.next_batch(lookahead) > 0;
+         }
+      }
+      lookahead.clear();
       std::optional<std::pair<K, V>> kv = merged_scanner.next();
       if (!kv) {
+         return false;
+      }
+      lookahead.push_back(kv->first, kv->second);
+      return true;
+   }
+
+   // False while read-ahead entries are buffered, the scanner is then past the last returned entry
+   bool scanner_on_last_returned() const { return lookahead_pos == lookahead.size; }
+
+   void discard_lookahead()
+   {
+      lookahead.clear();
+      lookahead_pos = 0;
+   }
+
+   // The returned references stay valid until the next pull
+   std::optional<Scanned> pull(bool batched)
+   {
+      if (lookahead_pos == lookahead.size && !refill(batched)) {
          return std::nullopt;
       }
-      auto& k = kv->first;
-      auto& v = kv->second;
+      const K& k = lookahead.keys[lookahead_pos];
+      const V& v = lookahead.records[lookahead_pos];
+      lookahead_pos++;
       JK jk;
       std::visit([&](auto& actual_key) -> void { jk = actual_key.get_jk(); }, k);
       if (seek_jk != JK::max() && jk.match(seek_jk) != 0) {
          return std::nullopt;  // past the seek_jk
       }
+      return Scanned{k, v, jk};
+   }
+
+   std::optional<std::tuple<K, V, JK>> scan_next(bool to_emplace = true)
+   {
+      auto scanned = pull(false);
+      if (!scanned) {
+         return std::nullopt;
+      }
       if (to_emplace)
-         emplace(k, v, jk);
-      return std::make_tuple(k, v, jk);
+         emplace(scanned->k, scanned->v, scanned->jk);
+      return std::make_tuple(scanned->k, scanned->v, scanned->jk);
    }
 
    std::tuple<int, int, int> distance(const JK& to_jk)
@@ -129,6 +263,7 @@ struct PremergedJoin {
    bool seek_next(const JK& to_jk)
    {
       typename R::Key k{to_jk};
+      discard_lookahead();
       merged_scanner.template seek<R>(k);
       stats.seek_cnt++;
       auto t = scan_next();
@@ -141,18 +276,57 @@ struct PremergedJoin {
       return cmp == 0;  // true if the cached record matches the seek_jk
    }
 
+   // to_jk to compare the keys of the scanner with while the lookahead is empty, if they are comparable folded
+   std::optional<FoldedJK<JK>> folded_target(const JK& to_jk) const
+   {
+      if constexpr (COMPARE_FOLDED) {
+         if (scanner_on_last_returned()) {
+            FoldedJK<JK> folded(to_jk);
+            if (folded.exact) {
+               return folded;
+            }
+         }
+      }
+      return std::nullopt;
+   }
+
+   // Whether the entry the scanner is on is before target, by its folded key; it is left undecoded then
+   bool folded_before(const FoldedJK<JK>& target)
+      requires COMPARE_FOLDED
+   {
+      u8 key[MAX_KEY_LENGTH];
+      const unsigned length = merged_scanner.folded_key(key);
+      return length > 0 && target.compare(key, length) < 0;
+   }
+
    template <typename R>
    bool scan_filter_next(const JK& to_jk, bool tentative = false, int tentative_skip_bytes = FLAGS_tentative_skip_bytes)
    {
       // scan until we find the first record with the right jk
       int bytes_scanned = 0;
+      inspected = 0;
+      const auto folded_to = folded_target(to_jk);
       while (!tentative || bytes_scanned < tentative_skip_bytes) {  // HARDCODED page size, scan 2 pages (2 next page calls)
-         auto t = scan_next(false);                                 // decide later whether to emplace
+         if constexpr (COMPARE_FOLDED) {
+            if (folded_to) {
+               if (!merged_scanner.advance()) {
+                  return false;  // exhausted scanner
+               }
+               if (folded_before(*folded_to)) {
+                  merged_scanner.consume();
+                  bytes_scanned += sizeof(K) + sizeof(V);
+                  inspected++;
+                  continue;
+               }
+            }
+         }
+         auto t = scan_next(false);  // decide later whether to emplace
          if (!t.has_value()) {
             return false;  // exhausted scanner
          }
          auto [k, v, jk] = t.value();
          bytes_scanned += sizeof(k) + sizeof(v);
+         inspected++;
          int cmp = jk.match(to_jk);
          if (cmp < 0) {
             continue;  // skip this record, it is before the seek_jk
@@ -169,6 +343,47 @@ struct PremergedJoin {
       return seek_next<R>(to_jk);  // seek the first record with the right jk
    }
 
+   // Like scan_filter_next, but only decodes the R entries of the current leaf; seeks once the leaf has no
+   // R entry left before to_jk. The skips pass over the entries of the other types, which is only safe up to
+   // to_jk: when there is no R entry for to_jk, the upper-level entries after it (e.g. the next city) may have
+   // been skipped, so it seeks to to_jk to continue from the first entry past it instead
+   template <typename R>
+   bool skip_filter_next(const JK& to_jk)
+   {
+      if (!scanner_on_last_returned()) {
+         return scan_filter_next<R>(to_jk, true);  // skips are relative to the scanner, the lookahead comes first
+      }
+      inspected = 0;
+      const auto folded_to = folded_target(to_jk);
+      while (merged_scanner.template skipToNextOfType<R>()) {
+         if constexpr (COMPARE_FOLDED) {
+            if (folded_to && folded_before(*folded_to)) {
+               merged_scanner.consume();
+               inspected++;
+               continue;
+            }
+         }
+         auto t = scan_next(false);  // decide later whether to emplace
+         if (!t.has_value()) {
+            return false;  // exhausted scanner
+         }
+         inspected++;
+         auto [k, v, jk] = t.value();
+         int cmp = jk.match(to_jk);
+         if (cmp < 0) {
+            continue;  // skip this record, it is before the seek_jk
+         }
+         if (cmp > 0) {
+            break;  // to_jk has no R entry, entries between it and this one may have been skipped
+         }
+         stats.scan_filter_success++;
+         emplace(k, v, jk);
+         return true;
+      }
+      stats.scan_filter_fail++;
+      return seek_next<R>(to_jk);
+   }
+
    template <typename R>
    bool right_next(const JK& to_jk)
    {
@@ -213,8 +428,20 @@ struct PremergedJoin {
       if (base == 0 && dist == 1) {
          return right_next<R>(to_jk_r);
       }
-      // 3 For downstream record types, tentatively scan
-      if (I >= sizeof...(Rs) - 2) {  // HARDCODED: the last 2 record types, county & city & customer2
+      if (FLAGS_adaptive_premerged_join) {
+         return adaptive_next<R>(to_jk_r, I >= DENSE_FROM);
+      }
+      // 3 For downstream record types, jump between the R entries of the leaf when the scanner knows their slots
+      if constexpr (requires { merged_scanner.template skipToNextOfType<R>(); }) {
+         if (I >= DENSE_FROM) {
+            return skip_filter_next<R>(to_jk_r);
+         }
+      }
+      // tentatively scan otherwise
+      if (I >= DENSE_FROM) {  // e.g. city & customer2 of the geo path
+         if (!scanner_on_last_returned()) {
+            return scan_filter_next<R>(to_jk_r, true);  // the page probe needs the scanner on the last returned entry
+         }
          auto last_kv_in_page = merged_scanner.last_in_page();
          int bytes_advanced = 0;
          if (last_kv_in_page.has_value()) {
@@ -238,6 +465,35 @@ struct PremergedJoin {
       }
    }
 
+   // Seeks or scans to to_jk, whichever the cost model expects to be cheaper; prior is the static choice
+   template <typename R>
+   bool adaptive_next(const JK& to_jk, bool prior)
+   {
+      auto [field, _, dist] = distance(to_jk);
+      const auto start = std::chrono::steady_clock::now();
+      auto elapsed_ns = [&start]() { return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count(); };
+      if (!cost_model.prefer_scan(field, dist, prior)) {
+         stats.chose_seek++;
+         const bool found = seek_next<R>(to_jk);
+         cost_model.observe_seek(elapsed_ns());
+         return found;
+      }
+      stats.chose_scan++;
+      const size_t fail_before = stats.scan_filter_fail;
+      bool found;
+      if constexpr (requires { merged_scanner.template skipToNextOfType<R>(); }) {
+         found = skip_filter_next<R>(to_jk);  // bounded by the leaf
+      } else {
+         const double expected = cost_model.expected_entries(field, dist);
+         const int budget = expected == 0 ? FLAGS_tentative_skip_bytes
+                                          : static_cast<int>(std::max(1.0, expected * PremergedCostModel::SCAN_BUDGET) * (sizeof(K) + sizeof(V)));
+         found = scan_filter_next<R>(to_jk, true, budget);
+      }
+      const bool gave_up = stats.scan_filter_fail != fail_before;  // and sought, which is timed in too
+      cost_model.observe_scan(field, dist, inspected, elapsed_ns(), !gave_up);
+      return found;
+   }
+
    template <size_t... Is>
    bool get_next_all(const JK& seek_jk, std::index_sequence<Is...>)
    {
@@ -256,10 +512,11 @@ struct PremergedJoin {
       }
 
       while (!join_state.has_next()) {
-         auto t = scan_next();
-         if (!t.has_value()) {
+         auto scanned = pull(true);
+         if (!scanned) {
             return std::nullopt;  // only return std::nullopt if the joiner reaches the end
          }
+         emplace(scanned->k, scanned->v, scanned->jk);
       }
       return join_state.next();
    }
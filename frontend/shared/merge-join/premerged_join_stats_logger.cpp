@@ -3,6 +3,7 @@
 #include "premerged_join.hpp"
 
 PremergedJoinStats PremergedJoinLogger::last_stats; // cannot be inlined because PremergedJoinStats was an incomplete type in the header
+PremergedCostModel PremergedJoinLogger::last_model;
 
 // This static instance ensures flush() is called automatically at the end of the program
 const static LoggerFlusher<PremergedJoinLogger> final_flusher;
@@ -18,7 +19,7 @@ void PremergedJoinLogger::init()
 
       // Write a clean CSV header
       log_file << "repeat_count,record_type_count,seek_cnt,right_next_cnt,"
-               << "scan_filter_success,scan_filter_fail,emplace_cnt,avg_remaining_records_to_join,avg_produced\n";
+               << "scan_filter_success,scan_filter_fail,emplace_cnt,chose_seek,chose_scan,avg_remaining_records_to_join,avg_produced\n";
 
       is_initialized = true;
    }
@@ -29,6 +30,7 @@ void PremergedJoinLogger::write_row()
    if (repeat_count > 0) {
       log_file << repeat_count << ',' << last_stats.record_type_count << ',' << last_stats.seek_cnt << ',' << last_stats.right_next_cnt << ','
                << last_stats.scan_filter_success << ',' << last_stats.scan_filter_fail << ',' << last_stats.emplace_cnt << ','
+               << last_stats.chose_seek << ',' << last_stats.chose_scan << ','
                << remaining_records_to_join_accumulated / repeat_count << ',' << produced_accumulated / repeat_count << std::endl;
    }
 }
@@ -61,6 +63,13 @@ void PremergedJoinLogger::log(const PremergedJoinStats& current_stats, size_t re
    produced_accumulated += produced;
 }
 
+void PremergedJoinLogger::log_model(const PremergedCostModel& model)
+{
+   std::lock_guard<std::mutex> lock(mtx);
+   last_model = model;
+   has_model = true;
+}
+
 void PremergedJoinLogger::flush()
 {
    std::lock_guard<std::mutex> lock(mtx);
@@ -70,6 +79,18 @@ void PremergedJoinLogger::flush()
    // Write the final pending row
    write_row();
 
+   // and the learned costs, one row per key field
+   if (has_model) {
+      std::ofstream model_file(std::filesystem::path(FLAGS_csv_path) / "premerged_join_model.csv", std::ios::trunc);
+      model_file << "field,fanout,scan_ns_per_entry,seek_ns\n";
+      for (size_t field = 0; field < PremergedCostModel::FIELDS; field++) {
+         if (last_model.fanout[field] != 0) {
+            model_file << field << ',' << last_model.fanout[field] << ',' << last_model.scan_ns_per_entry << ',' << last_model.seek_ns << '\n';
+         }
+      }
+      has_model = false;
+   }
+
    // Reset state and close the file
    repeat_count = 0;
    if (log_file.is_open()) {
@@ -0,0 +1,104 @@
+#pragma once
+#include <bit>
+#include <functional>
+#include <vector>
+#include "../flat_hash_multimap.hpp"
+#include "../view_templates.hpp"
+
+// Radix-partitioned hash join of two buffered inputs, one instance per worker.
+// Both sides are scattered into 2^bits partitions by the hash of the JK at R1's level, with bits chosen so
+// that a partition's build tuples and table stay within PARTITION_BYTES (about an L2 cache). Every partition
+// is then built and probed on its own. Unlike HashJoin, probe tuples only look up their R1-level key, and the
+// output follows the partition order instead of the probe order.
+template <typename JK, typename JR, typename R1, typename R2>
+class RadixHashJoin
+{
+  public:
+   static constexpr size_t PARTITION_BYTES = 256 * 1024;
+   using Consume = std::function<void(const typename JR::Key&, const JR&)>;
+
+   explicit RadixHashJoin(Consume consume = [](const typename JR::Key&, const JR&) {}) : consume(std::move(consume)) {}
+
+   void add_build(const typename R1::Key& k, const R1& v) { build.push_back(Tuple<R1>{SKBuilder<JK>::create(k, v), k, v}); }
+
+   void add_probe(const typename R2::Key& k, const R2& v)
+   {
+      probe.push_back(Tuple<R2>{SKBuilder<JK>::template get<R1>(SKBuilder<JK>::create(k, v)), k, v});
+   }
+
+   // Joins everything added so far, returns the number of joined records
+   long run()
+   {
+      const size_t build_bytes = build.size() * (sizeof(Tuple<R1>) + sizeof(typename Table::Entry) + 2 * (sizeof(u8) + sizeof(u32)));
+      bits = build_bytes <= PARTITION_BYTES ? 0 : std::bit_width((build_bytes - 1) / PARTITION_BYTES);
+      std::vector<size_t> build_bounds, probe_bounds;
+      scatter(build, build_bounds);
+      scatter(probe, probe_bounds);
+
+      long produced = 0;
+      for (size_t p = 0; p < build_bounds.size() - 1; p++) {
+         Table table(build_bounds[p + 1] - build_bounds[p]);
+         for (size_t i = build_bounds[p]; i < build_bounds[p + 1]; i++) {
+            table.emplace(build[i].jk, &build[i]);
+         }
+         for (size_t i = probe_bounds[p]; i < probe_bounds[p + 1]; i++) {
+            const auto& r = probe[i];
+            table.for_each_equal(r.jk, [&](const Tuple<R1>* l) {
+               consume(typename JR::Key{l->k, r.k}, JR{l->v, r.v});
+               produced++;
+            });
+         }
+      }
+      build.clear();
+      probe.clear();
+      return produced;
+   }
+
+   unsigned radix_bits() const { return bits; }
+
+  private:
+   template <typename R>
+   struct Tuple {
+      JK jk;  // at R1's level
+      typename R::Key k;
+      R v;
+   };
+   using Table = FlatHashMultimap<JK, const Tuple<R1>*>;
+
+   const Consume consume;
+   std::vector<Tuple<R1>> build;
+   std::vector<Tuple<R2>> probe;
+   unsigned bits = 0;
+
+   size_t partition_of(const JK& jk) const
+   {
+      // the table slots use the low bits of the same hash
+      return bits == 0 ? 0 : (flat_hash_mix(std::hash<JK>()(jk)) >> 32) & ((size_t(1) << bits) - 1);
+   }
+
+   // Two-pass radix scatter: histogram, prefix sums, then copy into place. bounds[p] is the first tuple of p
+   template <typename T>
+   void scatter(std::vector<T>& tuples, std::vector<size_t>& bounds) const
+   {
+      const size_t partitions = size_t(1) << bits;
+      bounds.assign(partitions + 1, 0);
+      if (partitions == 1) {
+         bounds[1] = tuples.size();
+         return;
+      }
+      std::vector<u32> partition_ids(tuples.size());
+      for (size_t i = 0; i < tuples.size(); i++) {
+         partition_ids[i] = partition_of(tuples[i].jk);
+         bounds[partition_ids[i] + 1]++;
+      }
+      for (size_t p = 0; p < partitions; p++) {
+         bounds[p + 1] += bounds[p];
+      }
+      std::vector<size_t> cursors(bounds.begin(), bounds.end() - 1);
+      std::vector<T> scattered(tuples.size());
+      for (size_t i = 0; i < tuples.size(); i++) {
+         scattered[cursors[partition_ids[i]]++] = tuples[i];
+      }
+      tuples.swap(scattered);
+   }
+};
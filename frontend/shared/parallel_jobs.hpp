@@ -0,0 +1,49 @@
+#pragma once
+#include <functional>
+#include "leanstore/concurrency-recovery/CRMG.hpp"
+
+// First CRManager worker after the calling one, i.e. after the background and main workers of executable_helper.hpp
+// when called from a transaction; 0 outside of a LeanStore worker (e.g. for RocksDB)
+inline u64 first_job_worker()
+{
+   auto* me = leanstore::cr::Worker::tls_ptr;
+   return (me != nullptr && me->worker_id < me->workers_count) ? me->worker_id + 1 : 0;
+}
+
+// Number of CRManager workers from first_worker on, 0 without a running LeanStore (e.g. for RocksDB)
+inline u64 available_job_workers(u64 first_worker)
+{
+   auto* crm = leanstore::cr::CRManager::global;
+   if (crm == nullptr || crm->workers_count <= first_worker) {
+      return 0;
+   }
+   return crm->workers_count - first_worker;
+}
+
+// Runs job(j) for j in [0, jobs), waits for all of them and returns the number of workers that ran them. Job 0 runs
+// on the calling thread within its transaction; with enough LeanStore workers, job j > 0 runs on worker
+// first_worker + j - 1 inside a read-only transaction that reads the caller's snapshot, so all jobs see the same
+// commits (but not the caller's own uncommitted writes). Otherwise, and outside of a LeanStore worker, all jobs run one
+// after another on the calling thread.
+inline u64 run_parallel_jobs(u64 first_worker, u64 jobs, const std::function<void(u64 j)>& job)
+{
+   if (jobs <= 1 || jobs - 1 > available_job_workers(first_worker) || leanstore::cr::Worker::tls_ptr == nullptr) {
+      for (u64 j = 0; j < jobs; j++) {
+         job(j);
+      }
+      return 1;
+   }
+   auto& crm = *leanstore::cr::CRManager::global;
+   auto& caller = leanstore::cr::activeTX();
+   const auto mode = caller.current_tx_mode;
+   const auto isolation_level = caller.current_tx_isolation_level;
+   const TXID snapshot = caller.startTS();
+   crm.scheduleJobs(first_worker, jobs - 1, [&](u64 t_i) {
+      leanstore::cr::Worker::my().startTX(mode, isolation_level, true, snapshot);
+      job(t_i - first_worker + 1);
+      leanstore::cr::Worker::my().commitTX();
+   });
+   job(0);
+   crm.joinJobs(first_worker, jobs - 1);
+   return jobs;
+}
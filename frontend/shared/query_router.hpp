@@ -0,0 +1,78 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <limits>
+#include "cost_learner.hpp"
+
+// Cost-based choice between equivalent access paths of a query, e.g. a materialized view, a merged index and a
+// join over the base indexes. Queries are grouped into classes with similar costs (query kind and selection depth).
+// Until a path has run for a class, its cost is a prior from statistics: the pages it is expected to read, each
+// weighted by whether it is likely resident. Afterwards it is the moving average of its measured latency, and every
+// CostLearner::EXPLORE_EVERY decisions the path that has waited longest is tried again.
+template <size_t PATHS, size_t CLASSES>
+class AccessPathRouter
+{
+  public:
+   static constexpr double RESIDENT_PAGE_NS = 1e3;  // priors only, replaced by measurements
+   static constexpr double MISSING_PAGE_NS = 1e5;
+
+   struct Estimate {
+      double ns = 0;
+      bool measured = false;
+   };
+
+   // pages: expected pages the path reads for a query of the class; resident: fraction of them expected in memory
+   void set_prior(size_t path, size_t cls, double pages, double resident)
+   {
+      Cost& c = costs[cls][path];
+      c.available = true;
+      if (!c.measured) {
+         c.ns = pages * (resident * RESIDENT_PAGE_NS + (1 - resident) * MISSING_PAGE_NS);
+      }
+   }
+
+   // allowed: the paths that may run this query, e.g. those that would read stale data are excluded
+   size_t choose(size_t cls, std::bitset<PATHS> allowed = std::bitset<PATHS>().set())
+   {
+      auto& paths = costs[cls];
+      auto usable = [&](size_t p) { return paths[p].available && allowed[p]; };
+      size_t best = PATHS;
+      for (size_t p = 0; p < PATHS; p++) {
+         if (usable(p) && (best == PATHS || paths[p].ns < paths[best].ns)) {
+            best = p;
+         }
+      }
+      if (CostLearner::explore(decisions[cls])) {
+         size_t stale = best;
+         for (size_t p = 0; p < PATHS; p++) {
+            if (usable(p) && paths[p].last_used < paths[stale].last_used) {
+               stale = p;
+            }
+         }
+         best = stale;
+      }
+      paths[best].last_used = decisions[cls];
+      return best;
+   }
+
+   Estimate estimate(size_t path, size_t cls) const { return {costs[cls][path].ns, costs[cls][path].measured}; }
+
+   void observe(size_t path, size_t cls, double ns)
+   {
+      Cost& c = costs[cls][path];
+      c.ns = CostLearner::update(c.measured ? c.ns : 0, ns);
+      c.measured = true;
+   }
+
+  private:
+   struct Cost {
+      double ns = std::numeric_limits<double>::max();
+      bool measured = false;
+      bool available = false;
+      size_t last_used = 0;
+   };
+   std::array<std::array<Cost, PATHS>, CLASSES> costs{};
+   std::array<size_t, CLASSES> decisions{};
+};
@@ -0,0 +1,135 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include "Units.hpp"
+#include "tx_hooks.hpp"
+
+// Bounded LRU cache of query results keyed by (query kind, selection), where a selection is a JK prefix such as
+// {nationkey, statekey, 0, 0, 0}. A change to the entry with key jk invalidates exactly the results whose selection is a
+// prefix of jk, one lookup per depth and kind; writers invalidate once they committed (TxHooks::on_commit). A result is
+// only inserted if no invalidation that matches it happened after the snapshot it was computed from was taken
+// (TxHooks::snapshot_epoch), as far as the last RECENT invalidations tell.
+// Queries look results up by their raw selection, which insert() maps to the selection the query extended it to; that
+// mapping must not change, as it does not for selections extended along static tables.
+template <typename JK, typename Value, size_t KINDS>
+class PrefixResultCache
+{
+  public:
+   static constexpr size_t RECENT = 1024;
+
+   struct Lookup {
+      std::optional<Value> value;
+      std::optional<JK> selection;  // what the raw selection was extended to, if known
+   };
+
+   explicit PrefixResultCache(size_t capacity) : capacity(capacity) {}
+
+   bool enabled() const { return capacity > 0; }
+
+   Lookup lookup(size_t kind, const JK& raw)
+   {
+      std::unique_lock lock(mutex);
+      auto alias = aliases.find(raw);
+      if (alias == aliases.end()) {
+         misses++;
+         return {std::nullopt, std::nullopt};
+      }
+      auto it = index.find(Key{kind, alias->second});
+      if (it == index.end()) {
+         misses++;
+         return {std::nullopt, alias->second};
+      }
+      hits++;
+      lru.splice(lru.begin(), lru, it->second);
+      return {it->second->second, alias->second};
+   }
+
+   // ticket: TxHooks::snapshot_epoch() of the transaction that computed value
+   void insert(size_t kind, const JK& raw, const JK& selection, const Value& value, u64 ticket)
+   {
+      if (!is_prefix(selection)) {
+         return;  // invalidate() would not find it
+      }
+      std::unique_lock lock(mutex);
+      for (u64 i = invalidations; i-- > 0 && recent[i % RECENT].second > ticket;) {
+         if (invalidations - i > RECENT || JK::hierarchy::match(selection, recent[i % RECENT].first) == 0) {
+            return;
+         }
+      }
+      if (aliases.size() >= capacity && !aliases.contains(raw)) {
+         aliases.erase(aliases.begin());
+      }
+      aliases.insert_or_assign(raw, selection);
+      const Key key{kind, selection};
+      if (auto it = index.find(key); it != index.end()) {
+         it->second->second = value;
+         lru.splice(lru.begin(), lru, it->second);
+         return;
+      }
+      lru.emplace_front(key, value);
+      index.emplace(key, lru.begin());
+      if (lru.size() > capacity) {
+         index.erase(lru.back().first);
+         lru.pop_back();
+      }
+   }
+
+   void invalidate(const JK& changed)
+   {
+      if (!enabled()) {
+         return;
+      }
+      std::unique_lock lock(mutex);
+      recent[invalidations++ % RECENT] = {changed, TxHooks::advance_epoch()};
+      for (size_t depth = 1; depth <= JK::hierarchy::depth; depth++) {
+         const JK prefix = JK::hierarchy::prefix(changed, depth);
+         for (size_t kind = 0; kind < KINDS; kind++) {
+            if (auto it = index.find(Key{kind, prefix}); it != index.end()) {
+               lru.erase(it->second);
+               index.erase(it);
+            }
+         }
+      }
+   }
+
+   // Hits and misses since the last call
+   std::pair<long, long> take_counters() { return {hits.exchange(0), misses.exchange(0)}; }
+
+  private:
+   struct Key {
+      size_t kind;
+      JK selection;
+      bool operator==(const Key& other) const { return kind == other.kind && selection == other.selection; }
+   };
+   struct KeyHash {
+      size_t operator()(const Key& k) const { return std::hash<JK>()(k.selection) * KINDS + k.kind; }
+   };
+
+   // set fields followed by wildcards only
+   static bool is_prefix(const JK& selection)
+   {
+      const auto fields = JK::hierarchy::values(selection);
+      size_t set = 0;
+      while (set < fields.size() && fields[set] != 0) {
+         set++;
+      }
+      return set > 0 && JK::hierarchy::prefix(selection, set) == selection;
+   }
+
+   const size_t capacity;
+   std::mutex mutex;
+   std::list<std::pair<Key, Value>> lru;  // most recently used first
+   std::unordered_map<Key, typename std::list<std::pair<Key, Value>>::iterator, KeyHash> index;
+   std::unordered_map<JK, JK> aliases;  // raw selection -> extended selection
+   std::array<std::pair<JK, u64>, RECENT> recent{};  // the last invalidations and their epochs, at their number % RECENT
+   u64 invalidations = 0;
+   std::atomic<long> hits = 0;
+   std::atomic<long> misses = 0;
+};
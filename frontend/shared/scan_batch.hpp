@@ -0,0 +1,134 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+constexpr size_t SCAN_BATCH_SIZE = 32;
+
+// Fixed-size batch of scanned entries; keys and records live in separate arrays so that
+// consumers touching only keys (e.g. to build join keys) stay in a few cache lines
+template <typename K, typename V, size_t N = SCAN_BATCH_SIZE>
+struct ScanBatch {
+   static constexpr size_t capacity = N;
+   std::array<K, N> keys;
+   std::array<V, N> records;
+   size_t size = 0;
+
+   void clear() { size = 0; }
+   bool empty() const { return size == 0; }
+   bool full() const { return size == N; }
+
+   void push_back(const K& k, const V& v)
+   {
+      keys[size] = k;
+      records[size] = v;
+      size++;
+   }
+};
+
+// Fetches the batches of a concrete source type with next_batch() (scanner or join), so that the calls can be inlined
+template <typename Source>
+struct SourceFetch {
+   Source* source;
+
+   SourceFetch(Source& source) : source(&source) {}
+
+   template <typename Batch>
+   size_t operator()(Batch& batch)
+   {
+      return source->next_batch(batch);
+   }
+   Source& underlying() { return *source; }
+};
+
+// Pull-based cursor over a batch source: one call per batch instead of one per record. By default the source is
+// type-erased (one indirect call per batch), see SourceCursor for concrete sources
+template <typename K, typename V, size_t N = SCAN_BATCH_SIZE, typename Fetch = std::function<size_t(ScanBatch<K, V, N>&)>>
+class BatchCursor
+{
+  public:
+   using Batch = ScanBatch<K, V, N>;
+   using FetchOne = std::function<std::optional<std::pair<K, V>>()>;
+
+   explicit BatchCursor(Fetch fetch_batch) : fetch_batch(std::move(fetch_batch)) {}
+
+   // Adapts a record-at-a-time source. It is read one record at a time, never ahead, because such
+   // sources may have side effects (counting, re-positioning the scanner) that callers rely on
+   explicit BatchCursor(FetchOne fetch_one)
+      requires std::is_same_v<Fetch, std::function<size_t(Batch&)>>
+       : fetch_batch([fetch_one = std::move(fetch_one)](Batch& batch) {
+            batch.clear();
+            auto kv = fetch_one();
+            if (kv) {
+               batch.push_back(kv->first, kv->second);
+            }
+            return batch.size;
+         })
+   {
+   }
+
+   // false once the source is exhausted
+   bool valid()
+   {
+      if (pos < batch.size) {
+         return true;
+      }
+      if (exhausted) {
+         return false;
+      }
+      pos = 0;
+      if (fetch_batch(batch) == 0) {
+         exhausted = true;
+         return false;
+      }
+      return true;
+   }
+
+   const K& key() const { return batch.keys[pos]; }
+   const V& record() const { return batch.records[pos]; }
+   void advance() { pos++; }
+   // Entries already fetched from the source, starting at the current one; used to prefetch ahead
+   size_t buffered() const { return batch.size - pos; }
+   const K& key_at(size_t offset) const { return batch.keys[pos + offset]; }
+   const V& record_at(size_t offset) const { return batch.records[pos + offset]; }
+   // Drops the buffered entries, e.g. when the source has been repositioned
+   void discard()
+   {
+      batch.clear();
+      pos = 0;
+      exhausted = false;
+   }
+   // The concrete source, e.g. to push a filter into it
+   auto& underlying()
+      requires requires(Fetch& f) { f.underlying(); }
+   {
+      return fetch_batch.underlying();
+   }
+
+  private:
+   Fetch fetch_batch;
+   Batch batch;
+   size_t pos = 0;
+   bool exhausted = false;
+};
+
+template <typename Source, typename K, typename V, size_t N = SCAN_BATCH_SIZE>
+using SourceCursor = BatchCursor<K, V, N, SourceFetch<Source>>;
+
+// Fills a batch from any source with a record-at-a-time next(), used by joins to expose next_batch()
+template <typename Source, typename K, typename V, size_t N>
+inline size_t fill_batch(Source& source, ScanBatch<K, V, N>& batch)
+{
+   batch.clear();
+   while (!batch.full()) {
+      auto kv = source.next();
+      if (!kv) {
+         break;
+      }
+      batch.push_back(kv->first, kv->second);
+   }
+   return batch.size;
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <utility>
+#include <vector>
+#include "Units.hpp"
+
+// Effects that have to wait for the outcome of the calling thread's transaction, e.g. dropping view deltas that a
+// fold wrote to the view. The DBTraits report begin(), committed() and aborted() on the thread that runs the
+// transaction. Outside of a transaction on_commit() runs the hook at once. A transaction that begins while the
+// previous one never reported its outcome counts that one as aborted.
+// Epochs order such effects against snapshots: snapshot_epoch() is the epoch before the snapshot of the running
+// transaction was taken, so an effect at a later epoch may be missing from it
+class TxHooks
+{
+  public:
+   static void on_commit(std::function<void()> hook)
+   {
+      State& s = state();
+      if (!s.active) {
+         hook();
+         return;
+      }
+      s.commit.push_back(std::move(hook));
+   }
+
+   static void on_abort(std::function<void()> hook)
+   {
+      State& s = state();
+      if (s.active) {
+         s.abort.push_back(std::move(hook));
+      }
+   }
+
+   // Before the transaction takes its snapshot
+   static void begin()
+   {
+      if (state().active) {
+         aborted();
+      }
+      state().active = true;
+      state().pending_epoch = epoch().load();
+   }
+   // Once it has, reused_snapshot if it kept the one of an earlier transaction (--si_refresh_rate)
+   static void started(bool reused_snapshot)
+   {
+      if (!reused_snapshot) {
+         state().snapshot_epoch = state().pending_epoch;
+      }
+   }
+   static void committed() { finish(state().commit); }
+   static void aborted() { finish(state().abort); }
+
+   static u64 advance_epoch() { return ++epoch(); }
+   static u64 snapshot_epoch() { return state().active ? state().snapshot_epoch : epoch().load(); }
+
+  private:
+   struct State {
+      bool active = false;
+      std::vector<std::function<void()>> commit;
+      std::vector<std::function<void()>> abort;
+      u64 pending_epoch = 0;
+      u64 snapshot_epoch = 0;
+   };
+
+   static std::atomic<u64>& epoch()
+   {
+      static std::atomic<u64> e = 0;
+      return e;
+   }
+
+   static State& state()
+   {
+      static thread_local State s;
+      return s;
+   }
+
+   // Hooks run outside of the transaction, so that those registering further hooks run them at once
+   static void finish(std::vector<std::function<void()>>& hooks)
+   {
+      State& s = state();
+      auto run = std::move(hooks);
+      s.commit.clear();
+      s.abort.clear();
+      s.active = false;
+      for (auto& hook : run) {
+         hook();
+      }
+   }
+};
@@ -1,5 +1,7 @@
 #pragma once
+#include <cstddef>
 #include <tuple>    // IWYU pragma: keep
+#include <type_traits>
 #include <variant>  // IWYU pragma: keep
 
 template <class... Ts>
@@ -13,4 +15,25 @@ template <typename Tuple, typename Func>
 static void for_each(Tuple& tup, Func func)
 {
    std::apply([&](auto&... elems) { (..., func(elems)); }, tup);
-}
\ No newline at end of file
+}
+// Position of T in Ts..., sizeof...(Ts) if it is none of them
+template <typename T, typename... Ts>
+constexpr size_t index_of_type()
+{
+   size_t i = 0;
+   ((std::is_same_v<T, Ts> ? false : (i++, true)) && ...);
+   return i;
+}
+
+// Visits the key of a merged entry together with the record of the same alternative
+template <typename... Ks, typename... Vs, typename F>
+decltype(auto) visit_entry(const std::variant<Ks...>& k, const std::variant<Vs...>& v, F&& f)
+{
+   static_assert(sizeof...(Ks) == sizeof...(Vs), "one key type per record type");
+   return std::visit(
+       [&](const auto& key) -> decltype(auto) {
+          constexpr size_t I = index_of_type<std::remove_cvref_t<decltype(key)>, Ks...>();
+          return f(key, *std::get_if<I>(&v));
+       },
+       k);
+}
@@ -4,46 +4,76 @@
 #include "leanstore/KVInterface.hpp"
 #include <rocksdb/slice.h>
 
+// Decodes a merged-index entry in place, without building temporaries (used by batch scans)
 template <typename... Records>
-inline std::pair<std::variant<typename Records::Key...>, std::variant<Records...>> toType(const leanstore::Slice& k, const leanstore::Slice& v)
+inline void assignType(const leanstore::Slice& k,
+                       const leanstore::Slice& v,
+                       std::variant<typename Records::Key...>& out_key,
+                       std::variant<Records...>& out_rec)
 {
    bool matched = false;
-   std::variant<typename Records::Key...> result_key;
-   std::variant<Records...> result_rec;
-
    (([&]() {
        if (!matched && k.size() == Records::maxFoldLength() && v.size() == sizeof(Records)) {
-          typename Records::Key key;
-          Records::unfoldKey(k.data(), key);
-          const Records& rec = *reinterpret_cast<const Records*>(v.data());
+          Records::unfoldKey(k.data(), out_key.template emplace<typename Records::Key>());
+          out_rec.template emplace<Records>(*reinterpret_cast<const Records*>(v.data()));
           matched = true;
-          result_key = key;
-          result_rec = rec;
        }
     })(),
     ...);
    assert(matched);
-   return std::make_pair(result_key, result_rec);
 }
 
 template <typename... Records>
-inline std::pair<std::variant<typename Records::Key...>, std::variant<Records...>> toType(const rocksdb::Slice& k, const rocksdb::Slice& v)
+inline void assignType(const rocksdb::Slice& k,
+                       const rocksdb::Slice& v,
+                       std::variant<typename Records::Key...>& out_key,
+                       std::variant<Records...>& out_rec)
 {
-   bool matched = false;
-   std::variant<typename Records::Key...> result_key;
-   std::variant<Records...> result_rec;
+   assignType<Records...>(leanstore::Slice(reinterpret_cast<const u8*>(k.data()), k.size()),
+                          leanstore::Slice(reinterpret_cast<const u8*>(v.data()), v.size()), out_key, out_rec);
+}
 
+// Decodes the key of a merged-index entry and calls f(const Key&, const Record&) with the record left in place
+// (used by zero-copy scans), returns what f returns
+template <typename... Records, typename F>
+inline bool visitType(const leanstore::Slice& k, const leanstore::Slice& v, F&& f)
+{
+   bool matched = false;
+   bool ret = true;
    (([&]() {
        if (!matched && k.size() == Records::maxFoldLength() && v.size() == sizeof(Records)) {
           typename Records::Key key;
-          Records::unfoldKey(reinterpret_cast<const u8*>(k.data()), key);
-          const Records& rec = *reinterpret_cast<const Records*>(v.data());
+          Records::unfoldKey(k.data(), key);
+          ret = f(key, *reinterpret_cast<const Records*>(v.data()));
           matched = true;
-          result_key = key;
-          result_rec = rec;
        }
     })(),
     ...);
    assert(matched);
+   return ret;
+}
+
+template <typename... Records, typename F>
+inline bool visitType(const rocksdb::Slice& k, const rocksdb::Slice& v, F&& f)
+{
+   return visitType<Records...>(leanstore::Slice(reinterpret_cast<const u8*>(k.data()), k.size()),
+                                leanstore::Slice(reinterpret_cast<const u8*>(v.data()), v.size()), std::forward<F>(f));
+}
+
+template <typename... Records>
+inline std::pair<std::variant<typename Records::Key...>, std::variant<Records...>> toType(const leanstore::Slice& k, const leanstore::Slice& v)
+{
+   std::variant<typename Records::Key...> result_key;
+   std::variant<Records...> result_rec;
+   assignType<Records...>(k, v, result_key, result_rec);
    return std::make_pair(result_key, result_rec);
-}
\ No newline at end of file
+}
+
+template <typename... Records>
+inline std::pair<std::variant<typename Records::Key...>, std::variant<Records...>> toType(const rocksdb::Slice& k, const rocksdb::Slice& v)
+{
+   std::variant<typename Records::Key...> result_key;
+   std::variant<Records...> result_rec;
+   assignType<Records...>(k, v, result_key, result_rec);
+   return std::make_pair(result_key, result_rec);
+}
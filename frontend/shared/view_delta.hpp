@@ -0,0 +1,304 @@
+#pragma once
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <vector>
+#include "delta_batch.hpp"
+#include "tx_hooks.hpp"
+
+// Deferred view maintenance: writers record their view changes here instead of in the view, readers merge them
+// into their scans, and fold() later applies them to the view in key order. The lock is only held to copy
+// entries, never across B-tree operations, so an aborted transaction cannot leave it taken. fold() copies the
+// entries and applies them, but they stay pending until the folding transaction commits (TxHooks): only then
+// are those that did not change meanwhile dropped. Until then readers, whose snapshots do not see the
+// uncommitted view writes, keep merging them in, and an abort leaves them to the next fold. One fold at a time.
+
+// Pending rows of a view: the latest state of every changed key
+template <typename Record>
+class PendingRows
+{
+  public:
+   using Key = typename Record::Key;
+   struct Row {
+      FoldedKeyOf<Record> folded;
+      Key key;
+      Record record;
+      bool present;  // inserted, erased otherwise
+   };
+
+   // Inserts a row that is not in the view yet
+   void insert(const Key& key, const Record& record)
+   {
+      std::unique_lock lock(mutex);
+      auto [it, inserted] = entries.try_emplace(FoldedKeyOf<Record>(key), Entry{key, record, true, false, 0});
+      if (!inserted) {
+         it->second.record = record;
+         it->second.present = true;
+      }
+      touch(it->second);
+   }
+
+   void erase(const Key& key)
+   {
+      std::unique_lock lock(mutex);
+      auto [it, inserted] = entries.try_emplace(FoldedKeyOf<Record>(key), Entry{key, Record{}, false, true, 0});
+      it->second.present = false;
+      touch(it->second);
+   }
+
+   size_t size() const
+   {
+      std::shared_lock lock(mutex);
+      return entries.size();
+   }
+
+   // Age of the oldest change that is not folded yet
+   std::chrono::steady_clock::duration staleness() const
+   {
+      std::shared_lock lock(mutex);
+      return oldest ? std::chrono::steady_clock::now() - *oldest : std::chrono::steady_clock::duration::zero();
+   }
+
+   // Scans view from `from` like Adapter::scan, with the pending rows merged in: cb(key, record) sees the rows as they
+   // are after the next fold, and returns false to stop. The pending rows are copied in small chunks along the way
+   template <typename View, typename CB>
+   void scan_merged(View& view, const Key& from, CB&& cb) const
+   {
+      Cursor pending(*this, from);
+      bool more = true;
+      view.scan(
+          from,
+          [&](const Key& k, const Record& r) {
+             const FoldedKeyOf<Record> folded(k);
+             for (const Row* row = pending.peek(); row != nullptr && row->folded < folded; row = pending.peek()) {
+                pending.pop();
+                if (row->present && !cb(row->key, row->record)) {
+                   return more = false;
+                }
+             }
+             if (const Row* row = pending.peek(); row != nullptr && row->folded == folded) {
+                pending.pop();
+                return more = !row->present || cb(row->key, row->record);  // replaced or erased
+             }
+             return more = cb(k, r);
+          },
+          []() {});
+      for (const Row* row = pending.peek(); more && row != nullptr; row = pending.peek()) {
+         pending.pop();
+         if (row->present) {
+            more = cb(row->key, row->record);
+         }
+      }
+   }
+
+   // Applies the pending rows to view and returns their number, 0 while another fold is not done yet
+   template <typename View>
+   size_t fold(View& view)
+   {
+      std::vector<std::pair<FoldedKeyOf<Record>, Entry>> applied;
+      const auto started = std::chrono::steady_clock::now();
+      {
+         std::unique_lock lock(mutex);
+         if (folding) {
+            return 0;
+         }
+         folding = true;
+         applied.assign(entries.begin(), entries.end());
+      }
+      TxHooks::on_abort([this]() {
+         std::unique_lock lock(mutex);
+         folding = false;
+      });
+      for (const auto& [folded, e] : applied) {
+         if (e.present && e.in_view) {
+            view.update1(e.key, [&](Record& r) { r = e.record; });
+         } else if (e.present) {
+            view.insert(e.key, e.record);
+         } else if (e.in_view) {
+            view.erase(e.key);
+         }
+      }
+      const size_t n = applied.size();
+      TxHooks::on_commit([this, applied = std::move(applied), started]() {
+         std::unique_lock lock(mutex);
+         for (const auto& [folded, e] : applied) {
+            auto it = entries.find(folded);
+            if (it->second.version == e.version) {
+               entries.erase(it);
+            } else {
+               it->second.in_view = e.present;
+            }
+         }
+         oldest = entries.empty() ? std::nullopt : std::optional(started);
+         folding = false;
+      });
+      return n;
+   }
+
+  private:
+   struct Entry {
+      Key key;
+      Record record;
+      bool present;
+      bool in_view;  // whether the view has the key, i.e. whether folding updates, inserts or erases it
+      u64 version;
+   };
+
+   // Reads the pending rows in key order, CHUNK at a time
+   class Cursor
+   {
+     public:
+      static constexpr size_t CHUNK = 64;
+
+      Cursor(const PendingRows& rows, const Key& from) : rows(rows), next_from(from) {}
+
+      const Row* peek()
+      {
+         if (pos == chunk.size() && !exhausted) {
+            refill();
+         }
+         return pos < chunk.size() ? &chunk[pos] : nullptr;
+      }
+      void pop() { pos++; }
+
+     private:
+      const PendingRows& rows;
+      FoldedKeyOf<Record> next_from;
+      bool inclusive = true;
+      bool exhausted = false;
+      std::vector<Row> chunk;
+      size_t pos = 0;
+
+      void refill()
+      {
+         chunk.clear();
+         pos = 0;
+         {
+            std::shared_lock lock(rows.mutex);
+            auto it = inclusive ? rows.entries.lower_bound(next_from) : rows.entries.upper_bound(next_from);
+            for (; it != rows.entries.end() && chunk.size() < CHUNK; ++it) {
+               chunk.push_back(Row{it->first, it->second.key, it->second.record, it->second.present});
+            }
+         }
+         exhausted = chunk.size() < CHUNK;
+         if (!chunk.empty()) {
+            next_from = chunk.back().folded;
+            inclusive = false;
+         }
+      }
+   };
+
+   mutable std::shared_mutex mutex;
+   std::map<FoldedKeyOf<Record>, Entry> entries;
+   u64 version = 0;
+   std::optional<std::chrono::steady_clock::time_point> oldest;
+   bool folding = false;
+
+   void touch(Entry& e)
+   {
+      e.version = ++version;
+      if (!oldest) {
+         oldest = std::chrono::steady_clock::now();
+      }
+   }
+};
+
+// Pending additive deltas of an aggregate view, e.g. the customer count per city
+template <typename Record>
+class PendingCounts
+{
+  public:
+   using Key = typename Record::Key;
+
+   void add(const Key& key, long delta)
+   {
+      std::unique_lock lock(mutex);
+      auto [it, inserted] = entries.try_emplace(FoldedKeyOf<Record>(key), Entry{key, 0});
+      it->second.delta += delta;
+      if (!oldest) {
+         oldest = std::chrono::steady_clock::now();
+      }
+   }
+
+   size_t size() const
+   {
+      std::shared_lock lock(mutex);
+      return entries.size();
+   }
+
+   std::chrono::steady_clock::duration staleness() const
+   {
+      std::shared_lock lock(mutex);
+      return oldest ? std::chrono::steady_clock::now() - *oldest : std::chrono::steady_clock::duration::zero();
+   }
+
+   // Sum of the pending deltas of the groups from `from` on while in_range(key)
+   template <typename InRange>
+   long sum(const Key& from, InRange&& in_range) const
+   {
+      std::shared_lock lock(mutex);
+      long total = 0;
+      for (auto it = entries.lower_bound(FoldedKeyOf<Record>(from)); it != entries.end() && in_range(it->second.key); ++it) {
+         total += it->second.delta;
+      }
+      return total;
+   }
+
+   // Applies the deltas to view: add_to(record, delta) for existing groups, create(delta) for new ones; 0 while
+   // another fold is not done yet. The applied deltas are subtracted once the transaction committed
+   template <typename View, typename AddTo, typename Create>
+   size_t fold(View& view, AddTo&& add_to, Create&& create)
+   {
+      std::vector<std::pair<FoldedKeyOf<Record>, Entry>> applied;
+      const auto started = std::chrono::steady_clock::now();
+      {
+         std::unique_lock lock(mutex);
+         if (folding) {
+            return 0;
+         }
+         folding = true;
+         applied.assign(entries.begin(), entries.end());
+      }
+      TxHooks::on_abort([this]() {
+         std::unique_lock lock(mutex);
+         folding = false;
+      });
+      for (const auto& [folded, e] : applied) {
+         if (e.delta == 0) {
+            continue;
+         }
+         if (view.tryLookup(e.key, [](const Record&) {})) {
+            view.update1(e.key, [&](Record& r) { add_to(r, e.delta); });
+         } else {
+            view.insert(e.key, create(e.delta));
+         }
+      }
+      const size_t n = applied.size();
+      TxHooks::on_commit([this, applied = std::move(applied), started]() {
+         std::unique_lock lock(mutex);
+         for (const auto& [folded, e] : applied) {
+            auto it = entries.find(folded);
+            it->second.delta -= e.delta;  // what was added meanwhile stays pending
+            if (it->second.delta == 0) {
+               entries.erase(it);
+            }
+         }
+         oldest = entries.empty() ? std::nullopt : std::optional(started);
+         folding = false;
+      });
+      return n;
+   }
+
+  private:
+   struct Entry {
+      Key key;
+      long delta;
+   };
+
+   mutable std::shared_mutex mutex;
+   std::map<FoldedKeyOf<Record>, Entry> entries;
+   std::optional<std::chrono::steady_clock::time_point> oldest;
+   bool folding = false;
+};